@@ -0,0 +1,162 @@
+#include <nodepp/nodepp.h>
+#include <wpgp/wpgp.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+using namespace nodepp;
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+/* Runs every wpgp_t benchmark and writes the results as JSON to the path
+   in WPGP_BENCH_OUT ( bench.json by default ). Each entry carries the
+   operation, its input size, ops/sec, p50/p99 latency in microseconds
+   and, for sized operations, throughput in MB/s. Built with -DWPGP_STATS
+   it also stores the per-stage counters. */
+
+array_t<object_t> result;
+
+double now_us() {
+    return std::chrono::duration<double,std::micro>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+template< class T >
+void bench( const string_t& name, ulong size, ulong count, T fn ) {
+    std::vector<double> list; double total = 0;
+
+    for( ulong x=0; x<count; x++ ){ double start = now_us();
+        fn(); double time = now_us() - start;
+        list.push_back( time ); total += time;
+    }   std::sort( list.begin(), list.end() );
+
+    double p50 = list[ list.size() * 50 / 100 ];
+    double p99 = list[ min( list.size() - 1, list.size() * 99 / 100 ) ];
+    double ops = count / ( total / 1e6 );
+
+    result.push( object_t({
+        { "op", name }, { "size", size }, { "count", count }, { "ops_sec", ops },
+        { "p50_us", p50 }, { "p99_us", p99 }, { "mb_sec", ops * size / 1048576.0 }
+    }));
+
+    console::log( name, size, ":", ops, "ops/sec", p50, "us p50", p99, "us p99" );
+}
+
+void save() {
+    auto path = process::env::get( "WPGP_BENCH_OUT" );
+    if( path.empty() ){ path = "bench.json"; }
+    auto file = fs::writable( path );
+    file.write( json::stringify( object_t({ { "results", result }, { "stats", wpgp::stats::snapshot() } }) ) );
+    console::log( "results written to", path );
+}
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+void bench_keys() {
+    ulong size [] = { 1024, 2048, 4096, 25519 };
+    ulong count[] = {   20,   10,    3,  1000 };
+
+    for( ulong x=0; x<4; x++ ){ bench( "create_new_user", size[x], count[x], [&](){
+        wpgp_t pgp; pgp.create_new_user( "bench", "bench@mail.com", "", 0, size[x] );
+    }); }
+
+    wpgp_t pgp; pgp.create_new_user( "bench", "bench@mail.com", "", 0, 2048 );
+    auto prv = pgp.write_private_key_to_memory();
+    auto pub = pgp.write_public_key_to_memory();
+
+    bench( "write_private_key_to_memory", 2048, 200, [&](){ pgp.write_private_key_to_memory(); });
+    bench( "write_public_key_to_memory" , 2048, 200, [&](){ pgp.write_public_key_to_memory();  });
+    bench( "read_private_key_from_memory", 2048, 200, [&](){ wpgp_t key; key.read_private_key_from_memory( prv ); });
+    bench( "read_public_key_from_memory" , 2048, 200, [&](){ wpgp_t key; key.read_public_key_from_memory ( pub ); });
+}
+
+void bench_messages( const wpgp_t& pgp, ulong chunk ) {
+    string_t mode = chunk == 0 ? "" : "_chunked"; pgp.set_chunk_size( chunk );
+
+    for( ulong size=16; size<=16777216; size*=16 ){
+        auto msg   = string_t( size, 'A' );
+        ulong count= max( 3ul, min( 1000ul, 67108864ul / size ) );
+        auto data  = pgp.encrypt_message( msg );
+
+        bench( "encrypt_message" + mode, size, count, [&](){ pgp.encrypt_message( msg  ); });
+        bench( "decrypt_message" + mode, size, count, [&](){ pgp.decrypt_message( data ); });
+    }
+
+    pgp.set_chunk_size( 0 );
+}
+
+void bench_into( const wpgp_t& pgp ) {
+    string_t enc, dec;
+
+    for( ulong size=16; size<=1048576; size*=16 ){
+        auto msg   = string_t( size, 'A' );
+        ulong count= max( 3ul, min( 1000ul, 67108864ul / size ) );
+        pgp.encrypt_message_into( msg, enc ); auto data = enc.slice( 0, pgp.encrypt_size( size ) );
+
+        bench( "encrypt_message_into", size, count, [&](){ pgp.encrypt_message_into( msg , enc ); });
+        bench( "decrypt_message_into", size, count, [&](){ pgp.decrypt_message_into( data, dec ); });
+    }
+}
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+/* pipes are asynchronous, so each one starts the next from its onClose */
+void bench_pipe( const string_t& prv, ulong size, ulong chunk, function_t<void> next ) {
+    string_t mode = chunk == 0 ? "" : "_chunked";
+
+    do { auto file = fs::writable( "bench.raw" ); auto data = string_t( 1048576, 'A' );
+         for( ulong x=0; x<size/1048576; x++ ){ file.write( data ); }
+    } while(0);
+
+    wpgp_t enc; enc.read_private_key_from_memory( prv ); enc.set_chunk_size( chunk );
+    double start = now_us();
+
+    enc.onClose([=](){ double time = now_us() - start;
+        result.push( object_t({ { "op", "encrypt_pipe" + mode }, { "size", size }, { "count", 1 },
+                                { "mb_sec", size / 1048576.0 / ( time / 1e6 ) } }));
+        console::log( "encrypt_pipe" + mode, size, ":", size / 1048576.0 / ( time / 1e6 ), "MB/s" );
+
+        wpgp_t dec; dec.read_private_key_from_memory( prv ); double start = now_us();
+
+        dec.onClose([=](){ double time = now_us() - start;
+            result.push( object_t({ { "op", "decrypt_pipe" + mode }, { "size", size }, { "count", 1 },
+                                    { "mb_sec", size / 1048576.0 / ( time / 1e6 ) } }));
+            console::log( "decrypt_pipe" + mode, size, ":", size / 1048576.0 / ( time / 1e6 ), "MB/s" );
+            next();
+        });
+
+        dec.decrypt_pipe( fs::readable( "bench.wpgp" ), fs::writable( "bench.out" ) );
+    });
+
+    enc.encrypt_pipe( fs::readable( "bench.raw" ), fs::writable( "bench.wpgp" ) );
+}
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+void onMain() {
+
+    bench_keys();
+
+    wpgp_t pgp; pgp.create_new_user( "bench", "bench@mail.com", "", 0, 2048 );
+    bench_messages( pgp, 0 ); bench_messages( pgp, 65536 ); bench_into( pgp );
+
+    do { auto data = pgp.encrypt_message( "Hello World" ); pgp.set_key_cache( 1024 );
+         bench( "decrypt_message_cached", 11, 1000, [&](){ pgp.decrypt_message( data ); });
+         pgp.set_key_cache( 0 );
+    } while(0);
+
+    wpgp_t ecc; ecc.create_new_user( "bench", "bench@mail.com", "", 0, 25519 );
+    do { auto data = ecc.encrypt_message( "Hello World" );
+         bench( "encrypt_message_x25519", 11, 1000, [&](){ ecc.encrypt_message( "Hello World" ); });
+         bench( "decrypt_message_x25519", 11, 1000, [&](){ ecc.decrypt_message( data ); });
+    } while(0);
+
+    auto prv = pgp.write_private_key_to_memory(); ulong size = 67108864;
+
+    bench_pipe( prv, size, 0, [=](){
+    bench_pipe( prv, size, 65536, [=](){ save(); });
+    });
+
+}
@@ -0,0 +1,21 @@
+#include <nodepp/nodepp.h>
+#include <wpgp/wpgp.h>
+
+using namespace nodepp;
+
+void onMain() { wpgp_t pgp, reader;
+
+    pgp.create_new_user( "EDBC", "EDBC@mail.com", "Hello World", 3, 2048 );
+    reader.read_private_key_from_memory( pgp.write_private_key_to_memory() );
+
+    pgp.set_format( "WPGB" ); string_t msg = "Hello World";
+    auto bin = pgp.encrypt_message( msg );
+
+    pgp.set_chunk_size( 4 );
+    auto chk = pgp.encrypt_message( msg );
+
+    /* the reader keeps the text format: the envelope magic decides */
+    console::log( reader.decrypt_message( bin ) == msg ? "WPGB: ok" : "WPGB: fail" );
+    console::log( reader.decrypt_message( chk ) == msg ? "WPGB chunked: ok" : "WPGB chunked: fail" );
+
+}
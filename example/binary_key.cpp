@@ -0,0 +1,19 @@
+#include <nodepp/nodepp.h>
+#include <wpgp/wpgp.h>
+
+using namespace nodepp;
+
+void onMain() { wpgp_t pgp, key;
+
+    pgp.create_new_user( "EDBC", "EDBC@mail.com", "Hello World", 3, 2048 );
+    pgp.set_format( "WPGB" );
+
+    auto raw = pgp.write_private_key_to_memory( "secret" );
+    key.read_private_key_from_memory( raw, "secret" );
+
+    string_t msg = "Hello World";
+    console::log( "key bytes:", raw.size() );
+    console::log( key.get_fingerprint() == pgp.get_fingerprint() ? "fingerprint: ok" : "fingerprint: fail" );
+    console::log( key.decrypt_message( pgp.encrypt_message( msg ) ) == msg ? "binary key: ok" : "binary key: fail" );
+
+}
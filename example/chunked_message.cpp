@@ -0,0 +1,18 @@
+#include <nodepp/nodepp.h>
+#include <wpgp/wpgp.h>
+
+using namespace nodepp;
+
+void onMain() { wpgp_t pgp, reader;
+
+    pgp.create_new_user( "EDBC", "EDBC@mail.com", "Hello World", 3, 2048 );
+    reader.read_private_key_from_memory( pgp.write_private_key_to_memory() );
+
+    pgp.set_chunk_size( 16 ); // tiny chunks, to get many of them
+    string_t msg = "Hello World, sealed in chunks of sixteen bytes";
+    auto enc = pgp.encrypt_message( msg );
+
+    /* readers pick the chunked format up on their own */
+    console::log( reader.decrypt_message( enc ) == msg ? "chunked: ok" : "chunked: fail" );
+
+}
@@ -0,0 +1,21 @@
+#include <nodepp/nodepp.h>
+#include <wpgp/wpgp.h>
+
+using namespace nodepp;
+
+void onMain() { wpgp_t pgp;
+
+    pgp.create_new_user( "EDBC", "EDBC@mail.com", "Hello World", 3, 2048 );
+    pgp.set_compression( 6 );
+
+    string_t msg; for( ulong x=0; x<4096; x++ ){ msg += "Hello World "; }
+    auto enc = pgp.encrypt_message( msg );
+
+    pgp.set_chunk_size( 1024 );
+    auto chk = pgp.encrypt_message( msg );
+
+    console::log( "plain:", msg.size(), "encrypted:", enc.size() );
+    console::log( pgp.decrypt_message( enc ) == msg ? "deflate: ok" : "deflate: fail" );
+    console::log( pgp.decrypt_message( chk ) == msg ? "deflate chunked: ok" : "deflate chunked: fail" );
+
+}
@@ -0,0 +1,18 @@
+#include <nodepp/nodepp.h>
+#include <wpgp/wpgp.h>
+
+using namespace nodepp;
+
+void onMain() { wpgp_t pgp;
+
+    /* keeps two 2048 bit keys ready in the background */
+    wpgp::keygen::reserve( 2048, 2 );
+
+    pgp.create_new_user_async( "EDBC", "EDBC@mail.com", "Hello World", 3, 2048, []( wpgp_t key ){
+        string_t msg = "Hello World";
+        console::log( key.decrypt_message( key.encrypt_message( msg ) ) == msg ? "keygen: ok" : "keygen: fail" );
+    });
+
+    console::log( "the event loop keeps running" );
+
+}
@@ -0,0 +1,23 @@
+#include <nodepp/nodepp.h>
+#include <wpgp/wpgp.h>
+
+using namespace nodepp;
+
+void onMain() { wpgp_t pgp;
+
+    pgp.create_new_user( "EDBC", "EDBC@mail.com", "Hello World", 3, 2048 );
+
+    string_t msg = "Hello World"; auto enc = pgp.encrypt_message( msg );
+    pgp.set_chunk_size( 8 ); auto chk = pgp.encrypt_message( msg );
+
+    pgp.onError([=]( except_t err ){ console::log( "async: fail" ); });
+
+    pgp.decrypt_message_async( enc, [=]( string_t data ){
+        console::log( data == msg ? "async: ok" : "async: fail" );
+    });
+
+    pgp.decrypt_message_async( chk, [=]( string_t data ){
+        console::log( data == msg ? "async chunked: ok" : "async chunked: fail" );
+    });
+
+}
@@ -0,0 +1,19 @@
+#include <nodepp/nodepp.h>
+#include <wpgp/wpgp.h>
+
+using namespace nodepp;
+
+void onMain() { wpgp_t pgp;
+
+    pgp.create_new_user( "EDBC", "EDBC@mail.com", "Hello World", 3, 2048 );
+    pgp.set_seekable( true ); pgp.set_chunk_size( 16 );
+
+    string_t msg; for( ulong x=0; x<100; x++ ){ msg += string_t( 1, 'a' + x % 26 ); }
+    do { auto file = fs::writable( "SEEK.wpgp" ); file.write( pgp.encrypt_message( msg ) ); file.close(); } while(0);
+
+    console::log( pgp.decrypt_range( "SEEK.wpgp", 40, 30 ) == msg.slice( 40, 70 ) ? "range: ok" : "range: fail" );
+
+    file_t file( "SEEK.wpgp", "r" ); auto enc = stream::await( file );
+    console::log( pgp.decrypt_message( enc ) == msg ? "whole: ok" : "whole: fail" );
+
+}
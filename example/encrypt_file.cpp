@@ -0,0 +1,20 @@
+#include <nodepp/nodepp.h>
+#include <wpgp/wpgp.h>
+
+using namespace nodepp;
+
+void onMain() { wpgp_t pgp;
+
+    pgp.create_new_user( "EDBC", "EDBC@mail.com", "Hello World", 3, 2048 );
+    pgp.set_seekable( true );
+
+    string_t msg; for( ulong x=0; x<10000; x++ ){ msg += "Hello World "; }
+    do { auto file = fs::writable( "PLAIN.txt" ); file.write( msg ); file.close(); } while(0);
+
+    if( !pgp.encrypt_file( "PLAIN.txt", "PLAIN.wpgp" ) ){ console::log( "file: fail" ); return; }
+    console::log( pgp.decrypt_range( "PLAIN.wpgp", 12, 11 ) == "Hello World" ? "file range: ok" : "file range: fail" );
+
+    pgp.onData([=]( string_t data ){ console::log( "piece:", data.size() ); });
+    pgp.decrypt_pipe( fs::readable( "PLAIN.wpgp" ) );
+
+}
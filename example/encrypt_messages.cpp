@@ -0,0 +1,17 @@
+#include <nodepp/nodepp.h>
+#include <wpgp/wpgp.h>
+
+using namespace nodepp;
+
+void onMain() { wpgp_t pgp;
+
+    pgp.create_new_user( "EDBC", "EDBC@mail.com", "Hello World", 3, 2048 );
+
+    auto msg = array_t<string_t>({ "Hello", "World", "Hello World" });
+    auto enc = pgp.encrypt_messages( msg );
+
+    for( ulong x=0; x<msg.size(); x++ ){
+         console::log( pgp.decrypt_message( enc[x] ) == msg[x] ? "batch: ok" : "batch: fail" );
+    }
+
+}
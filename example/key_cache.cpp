@@ -0,0 +1,17 @@
+#include <nodepp/nodepp.h>
+#include <wpgp/wpgp.h>
+
+using namespace nodepp;
+
+void onMain() { wpgp_t pgp;
+
+    pgp.create_new_user( "EDBC", "EDBC@mail.com", "Hello World", 3, 2048 );
+    pgp.set_key_cache( 64 );
+
+    string_t msg = "Hello World"; auto enc = pgp.encrypt_message( msg );
+
+    auto x = pgp.decrypt_message( enc ); // RSA unwrap
+    auto y = pgp.decrypt_message( enc ); // cache hit
+    console::log( x == msg && y == msg ? "cache: ok" : "cache: fail" );
+
+}
@@ -0,0 +1,20 @@
+#include <nodepp/nodepp.h>
+#include <wpgp/keyring.h>
+
+using namespace nodepp;
+
+void onMain() { wpgp_t alice, bob;
+
+    alice.create_new_user( "ALICE", "alice@mail.com", "Hello World", 3, 2048 );
+    bob  .create_new_user( "BOB"  , "bob@mail.com"  , "Hello World", 3, 2048 );
+
+    wpgp_keyring_t::write( "KEYRING.wpgr", array_t<wpgp_t>({ alice, bob }) );
+    wpgp_keyring_t ring( "KEYRING.wpgr" );
+
+    string_t msg = "Hello World";
+    auto enc = ring.get_by_mail( "bob@mail.com" ).encrypt_message( msg );
+
+    console::log( "keys:", ring.size() );
+    console::log( bob.decrypt_message( enc ) == msg ? "keyring: ok" : "keyring: fail" );
+
+}
@@ -0,0 +1,23 @@
+#include <nodepp/nodepp.h>
+#include <wpgp/wpgp.h>
+
+using namespace nodepp;
+
+void onMain() { wpgp_t pgp, reader;
+
+    pgp.create_new_user( "EDBC", "EDBC@mail.com", "Hello World", 3, 2048 );
+    reader.read_private_key_from_memory( pgp.write_private_key_to_memory() );
+
+    string_t msg = "Hello World", enc, dec;
+    if( pgp.encrypt_message_into( msg, enc ) < 0 ){ console::log( "into: fail" ); return; }
+
+    /* _into output is a regular chunked message */
+    console::log( reader.decrypt_message( enc ) == msg ? "into -> decrypt_message: ok" : "into -> decrypt_message: fail" );
+
+    long len = reader.decrypt_message_into( enc, dec );
+    console::log( len >= 0 && dec.slice( 0, len ) == msg ? "into -> into: ok" : "into -> into: fail" );
+
+    auto txt = pgp.encrypt_message( msg ); len = reader.decrypt_message_into( txt, dec );
+    console::log( len >= 0 && dec.slice( 0, len ) == msg ? "message -> into: ok" : "message -> into: fail" );
+
+}
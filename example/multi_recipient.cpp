@@ -0,0 +1,21 @@
+#include <nodepp/nodepp.h>
+#include <wpgp/wpgp.h>
+
+using namespace nodepp;
+
+void onMain() { wpgp_t alice, bob;
+
+    alice.create_new_user( "ALICE", "alice@mail.com", "Hello World", 3, 2048 );
+    bob  .create_new_user( "BOB"  , "bob@mail.com"  , "Hello World", 3, 2048 );
+
+    wpgp_t to_alice, to_bob;
+    to_alice.read_public_key_from_memory( alice.write_public_key_to_memory() );
+    to_bob  .read_public_key_from_memory( bob  .write_public_key_to_memory() );
+
+    string_t msg = "Hello World";
+    auto enc = to_alice.encrypt_message( msg, array_t<wpgp_t>({ to_alice, to_bob }) );
+
+    console::log( alice.decrypt_message( enc ) == msg ? "alice: ok" : "alice: fail" );
+    console::log( bob  .decrypt_message( enc ) == msg ? "bob: ok"   : "bob: fail"   );
+
+}
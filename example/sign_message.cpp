@@ -0,0 +1,16 @@
+#include <nodepp/nodepp.h>
+#include <wpgp/wpgp.h>
+
+using namespace nodepp;
+
+void onMain() { wpgp_t pgp, pub;
+
+    pgp.create_new_user( "EDBC", "EDBC@mail.com", "Hello World", 3, 2048 );
+    pub.read_public_key_from_memory( pgp.write_public_key_to_memory() );
+
+    auto sig = pgp.sign( "Hello World" );
+
+    console::log( pub.verify( "Hello World", sig ) ? "verify: ok" : "verify: fail" );
+    console::log( pub.verify( "Hello Worle", sig ) ? "tamper: fail" : "tamper: ok" );
+
+}
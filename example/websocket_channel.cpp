@@ -0,0 +1,85 @@
+#include <nodepp/nodepp.h>
+#include <nodepp/ws.h>
+#include <wpgp/channel.h>
+
+using namespace nodepp;
+
+/* a wpgp_channel_t is pairwise, so the server pairs exactly two peers and
+   refuses any other; once both are in, it tells the first one to start
+   the handshake */
+
+void server() {
+
+    ptr_t<queue_t<ws_t>> list = new queue_t<ws_t>();
+    auto server = ws::server();
+
+    server.onConnect([=]( ws_t cli ){
+        if( list->size() >= 2 ){ cli.close(); return; }
+        list->push(cli); auto ID=list->last();
+
+        cli.onData([=]( string_t data ){
+            auto x = list->first(); while( x!=nullptr ){ 
+                if( x!=ID ){ x->data.write(data); } x = x->next;
+            }
+        });
+
+        cli.onClose([=](){ list->erase(ID); 
+            console::log("disconnected");
+        }); console::log("connected");
+
+        if( list->size() == 2 ){ list->first()->data.write("PAIR"); }
+
+    });
+
+    wpgp_t pgp;
+    pgp.create_new_user( 
+        "EDBC",          // Name
+        "EDBC@mail.com", // Mail (Optional)
+        "Hello World 1", // Comment
+        3,               // Expiration (DAYS)
+        2048             // RSA size
+    );
+
+    pgp.write_private_key( "PRIVATE.wpgp" );
+
+    server.listen( "localhost", 8000, [=](...){
+        console::log("-> ws://localhost:8000");
+    });
+
+}
+
+void client() {
+
+    auto client = ws::client( "ws://localhost:8000" );
+    auto cin    = fs::std_input(); wpgp_t pgp;
+    pgp.read_private_key( "PRIVATE.wpgp" );
+    wpgp_key_t key( pgp ); wpgp_channel_t chn( key );
+
+    client.onConnect([=]( ws_t cli ){
+        
+        cli.onClose([](){
+            console::log("diconnected");
+            process::exit(1);
+        }); console::log("connected");
+
+        cin.onData([=]( string_t data ){ 
+            if( !chn.is_ready() ){ return; } cli.write( chn.encrypt(data) ); 
+        });
+
+        cli.onData([=]( string_t data ){
+            if( data == "PAIR" ){ cli.write( chn.handshake() ); return; }
+            if( !chn.is_ready() ){ if( chn.accept(data) && !chn.is_ready() )
+              { cli.write( chn.handshake() ); } return; }
+            console::log( chn.decrypt(data) );
+        });
+
+    });
+
+    stream::pipe( cin );
+
+}
+
+void onMain() {
+    if( process::env::get("mode")=="server" )
+      { server(); } else { client(); }
+}
@@ -4,6 +4,10 @@
 
 using namespace nodepp;
 
+/* the server relays every message to all the other clients, so each one
+   is sealed on its own with encrypt_message; see websocket_channel.cpp
+   for a pairwise wpgp_channel_t between two peers */
+
 void server() {
 
     ptr_t<queue_t<ws_t>> list = new queue_t<ws_t>();
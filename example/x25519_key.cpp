@@ -0,0 +1,17 @@
+#include <nodepp/nodepp.h>
+#include <wpgp/wpgp.h>
+
+using namespace nodepp;
+
+void onMain() { wpgp_t pgp, pub;
+
+    pgp.create_new_user( "EDBC", "EDBC@mail.com", "Hello World", 3, wpgp::ecc::SIZE );
+    pub.read_public_key_from_memory( pgp.write_public_key_to_memory() );
+
+    string_t msg = "Hello World";
+    auto enc = pub.encrypt_message( msg );
+
+    console::log( pgp.write_public_key_to_memory() );
+    console::log( pgp.decrypt_message( enc ) == msg ? "x25519: ok" : "x25519: fail" );
+
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2023 The Nodepp Project Authors. All Rights Reserved.
+ *
+ * Licensed under the MIT (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://github.com/NodeppOficial/nodepp/blob/main/LICENSE
+ */
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#ifndef NODEPP_WPGP_AEAD
+#define NODEPP_WPGP_AEAD
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#include <nodepp/nodepp.h>
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+#include <openssl/rand.h>
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+namespace nodepp { namespace wpgp { namespace aead {
+
+    enum { KEY = 32, SALT = 4, NONCE = 12, TAG = 16 };
+
+    /*─······································································─*/
+
+    inline bool random( void* out, ulong size ) noexcept {
+        return RAND_bytes( (uchar*) out, (int) size ) == 1;
+    }
+
+    inline void digest( const void* in, ulong size, uchar* out ) noexcept {
+        SHA256( (const uchar*) in, size, out );
+    }
+
+    inline void ratchet( uchar* key ) noexcept {
+        uchar buf[ KEY + 10 ]; memcpy( buf, key, KEY );
+        memcpy( buf + KEY, "WPGP-REKEY", 10 ); digest( buf, sizeof( buf ), key );
+        OPENSSL_cleanse( buf, sizeof( buf ) );
+    }
+
+    /*─······································································─*/
+
+    inline void set_uint64( uchar* out, ullong value ) noexcept {
+        for( int x=7; x>=0; x-- ){ out[x] = value & 0xff; value >>= 8; }
+    }
+
+    inline ullong get_uint64( const uchar* in ) noexcept { ullong value = 0;
+        for( int x=0; x<8; x++ ){ value = ( value << 8 ) | in[x]; } return value;
+    }
+
+    inline void nonce( uchar* out, const uchar* salt, ullong counter ) noexcept {
+        memcpy( out, salt, SALT ); set_uint64( out + SALT, counter );
+    }
+
+}}}
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+namespace nodepp { namespace wpgp { class aead_t {
+protected:
+
+    struct NODE {
+        EVP_CIPHER_CTX* enc = nullptr;
+        EVP_CIPHER_CTX* dec = nullptr;
+       ~NODE(){ EVP_CIPHER_CTX_free( enc ); EVP_CIPHER_CTX_free( dec ); }
+    };  ptr_t<NODE> obj;
+
+public:
+
+    aead_t() noexcept : obj( new NODE() ) {
+        obj->enc = EVP_CIPHER_CTX_new(); EVP_EncryptInit_ex( obj->enc, EVP_aes_256_gcm(), nullptr, nullptr, nullptr );
+        obj->dec = EVP_CIPHER_CTX_new(); EVP_DecryptInit_ex( obj->dec, EVP_aes_256_gcm(), nullptr, nullptr, nullptr );
+    }
+
+    /*─······································································─*/
+
+    /* out receives size bytes of ciphertext followed by a TAG byte tag;
+       in and out may point at the same buffer. */
+    bool seal( const uchar* key, const uchar* nonce, const uchar* aad, ulong alen,
+               const uchar* in , ulong size, uchar* out ) const noexcept { int len = 0;
+        if( EVP_EncryptInit_ex( obj->enc, nullptr, nullptr, key, nonce ) != 1 ){ return false; }
+        if( alen > 0 && EVP_EncryptUpdate( obj->enc, nullptr, &len, aad, alen ) != 1 ){ return false; }
+        if( size > 0 && EVP_EncryptUpdate( obj->enc, out, &len, in, size ) != 1 ){ return false; }
+        if( EVP_EncryptFinal_ex( obj->enc, out + size, &len ) != 1 ){ return false; }
+        return EVP_CIPHER_CTX_ctrl( obj->enc, EVP_CTRL_GCM_GET_TAG, aead::TAG, out + size ) == 1;
+    }
+
+    /* in holds size bytes of ciphertext followed by its TAG byte tag;
+       out receives size bytes of plaintext. */
+    bool open( const uchar* key, const uchar* nonce, const uchar* aad, ulong alen,
+               const uchar* in , ulong size, uchar* out ) const noexcept { int len = 0;
+        if( EVP_DecryptInit_ex( obj->dec, nullptr, nullptr, key, nonce ) != 1 ){ return false; }
+        if( alen > 0 && EVP_DecryptUpdate( obj->dec, nullptr, &len, aad, alen ) != 1 ){ return false; }
+        if( size > 0 && EVP_DecryptUpdate( obj->dec, out, &len, in, size ) != 1 ){ return false; }
+        if( EVP_CIPHER_CTX_ctrl( obj->dec, EVP_CTRL_GCM_SET_TAG, aead::TAG, (void*)( in + size ) ) != 1 ){ return false; }
+        return EVP_DecryptFinal_ex( obj->dec, out + size, &len ) == 1;
+    }
+
+};}}
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#endif
@@ -0,0 +1,182 @@
+/*
+ * Copyright 2023 The Nodepp Project Authors. All Rights Reserved.
+ *
+ * Licensed under the MIT (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://github.com/NodeppOficial/nodepp/blob/main/LICENSE
+ */
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#ifndef NODEPP_WPGP_CHANNEL
+#define NODEPP_WPGP_CHANNEL
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#include "wpgp.h"
+#include "aead.h"
+#include "key.h"
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+namespace nodepp { class wpgp_channel_t {
+protected:
+
+    struct KEY {
+        bool   state=0;
+        uchar  key [ wpgp::aead::KEY  ];
+        uchar  salt[ wpgp::aead::SALT ];
+        ullong seq  =0; // next sequence number
+        ullong epoch=0; // rekey generation of key
+        ulong  rekey=1; // messages per key generation
+        bool   bin  =0; // frames are raw rather than base64
+    };
+
+    /* per connection state only: both keys are shared handles, and the
+       cipher contexts are per thread rather than per channel */
+    struct NODE {
+        wpgp_key_t local ; // private key: unwraps the peer handshake
+        wpgp_key_t remote; // public  key: wraps our session key
+        ulong      rekey ; // messages per key generation we announce
+        KEY tx, rx;
+        NODE( const wpgp_key_t& _local, const wpgp_key_t& _remote ) noexcept : local( _local ), remote( _remote ) {}
+       ~NODE(){ OPENSSL_cleanse( &tx, sizeof( KEY ) ); OPENSSL_cleanse( &rx, sizeof( KEY ) ); }
+    };  ptr_t<NODE> obj;
+
+    /*─······································································─*/
+
+    static const wpgp::aead_t& aead() noexcept { static thread_local wpgp::aead_t aead; return aead; }
+
+    void ratchet( KEY& key, ullong epoch ) const noexcept {
+        while( key.epoch < epoch ){ wpgp::aead::ratchet( key.key ); key.epoch++; }
+    }
+
+public:
+
+    event_t<except_t> onError;
+
+    /*─······································································─*/
+
+    wpgp_channel_t( const wpgp_key_t& local, const wpgp_key_t& remote, ulong rekey=65536 ) noexcept 
+    : obj( new NODE( local, remote ) ) { obj->rekey = rekey==0 ? 1 : rekey; }
+
+    wpgp_channel_t( const wpgp_key_t& key, ulong rekey=65536 ) noexcept 
+    : wpgp_channel_t( key, key, rekey ) {}
+
+    /* each call takes new handles; servers with many connections should
+       build their wpgp_key_t once and pass it instead */
+    wpgp_channel_t( const wpgp_t& local, const wpgp_t& remote, ulong rekey=65536 ) noexcept 
+    : wpgp_channel_t( wpgp_key_t( local ), wpgp_key_t( remote ), rekey ) {}
+
+    wpgp_channel_t( const wpgp_t& pgp, ulong rekey=65536 ) noexcept 
+    : wpgp_channel_t( wpgp_key_t( pgp ), rekey ) {}
+
+    /*─······································································─*/
+
+    bool is_ready() const noexcept { return obj->tx.state && obj->rx.state; }
+
+    /* frames are sent raw when the remote key uses the binary format; the
+       choice is announced in the handshake, and incoming frames are read
+       in the format the peer announced */
+    bool is_binary() const noexcept { return obj->remote.is_binary(); }
+
+    /*─······································································─*/
+
+    string_t handshake() const noexcept {
+        if( !obj->tx.state ){ KEY& tx = obj->tx;
+            if( !wpgp::aead::random( tx.key , sizeof( tx.key  ) ) ||
+                !wpgp::aead::random( tx.salt, sizeof( tx.salt ) ) )
+              { WPGP_ERROR( onError, "Invalid WPGP channel" ); return nullptr; }
+            tx.seq = 0; tx.epoch = 0; tx.rekey = obj->rekey; tx.bin = is_binary(); tx.state = 1;
+        }
+
+        return obj->remote.encrypt_message( json::stringify( object_t({
+            { "type" , "CHANNEL" }, { "rekey", obj->tx.rekey }, { "binary", obj->tx.bin },
+            { "key"  , encoder::base64::get( string_t( (char*) obj->tx.key , sizeof( obj->tx.key  ) ) ) },
+            { "salt" , encoder::base64::get( string_t( (char*) obj->tx.salt, sizeof( obj->tx.salt ) ) ) }
+        })));
+    }
+
+    /* a channel accepts a single handshake: handshakes carry no freshness,
+       so a replayed one would rewind rx.seq and let old frames decrypt
+       again. Rekeying happens through the ratchet, or on a new channel. */
+    bool accept( const string_t& msg ) const noexcept {
+        if( msg.size() < 4 || memcmp( msg.get(), "WPG", 3 ) != 0 ){ return false; }
+        if( obj->rx.state ){ WPGP_ERROR( onError, "Invalid WPGP handshake" ); return false; }
+    try {
+
+        auto data = json::parse( obj->local.decrypt_message( msg ) );
+        if( data["type"].as<string_t>() != "CHANNEL" ){ throw except_t( "Invalid WPGP handshake" ); }
+
+        auto key  = encoder::base64::set( data["key"] .as<string_t>() );
+        auto salt = encoder::base64::set( data["salt"].as<string_t>() );
+
+        if( key.size()  != wpgp::aead::KEY || salt.size() != wpgp::aead::SALT )
+          { throw except_t( "Invalid WPGP handshake" ); }
+
+        KEY& rx = obj->rx; memcpy( rx.key, key.get(), key.size() ); 
+        memcpy( rx.salt, salt.get(), salt.size() ); rx.rekey = max( data["rekey"].as<ulong>(), 1ul );
+        rx.bin = data.has( "binary" ) && data["binary"].as<bool>();
+        rx.seq = 0; rx.epoch = 0; rx.state = 1; return true;
+
+    } catch(...) {
+        WPGP_ERROR( onError, "Invalid WPGP handshake" );
+        return false;
+    }}
+
+    /*─······································································─*/
+
+    string_t encrypt( const string_t& msg ) const noexcept {
+        KEY& tx = obj->tx; if( !tx.state )
+          { WPGP_ERROR( onError, "Invalid WPGP channel" ); return nullptr; }
+
+        uchar nonce[ wpgp::aead::NONCE ]; ullong seq = tx.seq++;
+        ratchet( tx, seq / tx.rekey ); wpgp::aead::nonce( nonce, tx.salt, seq );
+
+        auto data = string_t( 8 + msg.size() + wpgp::aead::TAG, '\0' );
+        auto raw  = (uchar*) data.get(); wpgp::aead::set_uint64( raw, seq );
+
+        if( !aead().seal( tx.key, nonce, raw, 8, (uchar*) msg.get(), msg.size(), raw + 8 ) )
+          { WPGP_ERROR( onError, "Invalid WPGP channel" ); return nullptr; }
+
+        return tx.bin ? data : encoder::base64::get( data );
+    }
+
+    string_t decrypt( const string_t& msg ) const noexcept {
+        KEY& rx = obj->rx; auto data = rx.bin ? msg : encoder::base64::set( msg );
+        
+        if( !rx.state || data.size() < 8 + wpgp::aead::TAG )
+          { WPGP_ERROR( onError, "Invalid WPGP frame" ); return nullptr; }
+
+        uchar nonce[ wpgp::aead::NONCE ]; auto raw = (uchar*) data.get();
+        ullong seq = wpgp::aead::get_uint64( raw ); ulong size = data.size() - 8 - wpgp::aead::TAG;
+
+        if( seq < rx.seq || seq / rx.rekey - rx.epoch > 1024 )
+          { WPGP_ERROR( onError, "Invalid WPGP frame" ); return nullptr; }
+
+        KEY key = rx; ratchet( key, seq / key.rekey ); 
+        wpgp::aead::nonce( nonce, key.salt, seq );
+
+        auto out = string_t( size, '\0' );
+        if( !aead().open( key.key, nonce, raw, 8, raw + 8, size, (uchar*) out.get() ) ){ 
+            OPENSSL_cleanse( &key, sizeof( KEY ) );
+            WPGP_ERROR( onError, "Invalid WPGP frame" ); return nullptr; 
+        }
+
+        key.seq = seq + 1; rx = key; 
+        OPENSSL_cleanse( &key, sizeof( KEY ) ); return out;
+    }
+
+    /*─······································································─*/
+
+    void free() const noexcept {
+        OPENSSL_cleanse( &obj->tx, sizeof( KEY ) ); 
+        OPENSSL_cleanse( &obj->rx, sizeof( KEY ) );
+    }
+
+};}
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#endif
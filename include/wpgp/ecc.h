@@ -0,0 +1,113 @@
+/*
+ * Copyright 2023 The Nodepp Project Authors. All Rights Reserved.
+ *
+ * Licensed under the MIT (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://github.com/NodeppOficial/nodepp/blob/main/LICENSE
+ */
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#ifndef NODEPP_WPGP_ECC
+#define NODEPP_WPGP_ECC
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#include <nodepp/nodepp.h>
+#include <openssl/evp.h>
+#include "aead.h"
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+/* X25519 keys as raw 32 byte strings. seal() wraps data for a public key
+   with an ephemeral key pair: the AES-256-GCM key is
+   SHA256( X25519( eph, pub ) || eph_pub || pub ), and eph_pub is stored in
+   front of the ciphertext. Every key is used once, so the nonce is zero. */
+
+namespace nodepp { namespace wpgp { namespace ecc {
+
+    enum { KEY = 32, SIZE = 25519, SALT = 16, ROUNDS = 200000 };
+    enum { SEAL = KEY + aead::TAG, LOCK = SALT + KEY + aead::TAG };
+
+    /*─······································································─*/
+
+    inline bool generate( uchar* prv, uchar* pub ) noexcept {
+        EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id( EVP_PKEY_X25519, nullptr );
+        EVP_PKEY* key = nullptr; size_t a = KEY, b = KEY;
+        bool done = ctx != nullptr && EVP_PKEY_keygen_init( ctx ) > 0 && EVP_PKEY_keygen( ctx, &key ) > 0 &&
+                    EVP_PKEY_get_raw_private_key( key, prv, &a ) > 0 &&
+                    EVP_PKEY_get_raw_public_key ( key, pub, &b ) > 0;
+        EVP_PKEY_free( key ); EVP_PKEY_CTX_free( ctx ); return done;
+    }
+
+    inline bool public_key( const uchar* prv, uchar* pub ) noexcept {
+        EVP_PKEY* key = EVP_PKEY_new_raw_private_key( EVP_PKEY_X25519, nullptr, prv, KEY ); size_t len = KEY;
+        bool done = key != nullptr && EVP_PKEY_get_raw_public_key( key, pub, &len ) > 0;
+        EVP_PKEY_free( key ); return done;
+    }
+
+    /* out = SHA256( X25519( prv, peer ) || eph || rcpt ) */
+    inline bool derive( const uchar* prv, const uchar* peer, const uchar* eph, const uchar* rcpt, uchar* out ) noexcept {
+        EVP_PKEY* a = EVP_PKEY_new_raw_private_key( EVP_PKEY_X25519, nullptr, prv , KEY );
+        EVP_PKEY* b = EVP_PKEY_new_raw_public_key ( EVP_PKEY_X25519, nullptr, peer, KEY );
+        EVP_PKEY_CTX* ctx = a == nullptr ? nullptr : EVP_PKEY_CTX_new( a, nullptr );
+        uchar buf[ KEY * 3 ]; size_t len = KEY;
+
+        bool done = ctx != nullptr && b != nullptr && EVP_PKEY_derive_init( ctx ) > 0 &&
+                    EVP_PKEY_derive_set_peer( ctx, b ) > 0 && EVP_PKEY_derive( ctx, buf, &len ) > 0 && len == KEY;
+        if( done ){ memcpy( buf + KEY, eph, KEY ); memcpy( buf + KEY * 2, rcpt, KEY ); aead::digest( buf, sizeof( buf ), out ); }
+
+        OPENSSL_cleanse( buf, sizeof( buf ) ); EVP_PKEY_CTX_free( ctx );
+        EVP_PKEY_free( a ); EVP_PKEY_free( b ); return done;
+    }
+
+    /*─······································································─*/
+
+    /* out receives SEAL + size bytes: eph_pub, ciphertext and tag */
+    inline bool seal( const uchar* pub, const uchar* in, ulong size, uchar* out ) noexcept {
+        uchar eph[ KEY ], kek[ KEY ], nonce[ aead::NONCE ] = {0};
+        static thread_local aead_t aead;
+
+        bool done = generate( eph, out ) && derive( eph, pub, out, pub, kek ) &&
+                    aead.seal( kek, nonce, nullptr, 0, in, size, out + KEY );
+        OPENSSL_cleanse( eph, KEY ); OPENSSL_cleanse( kek, KEY ); return done;
+    }
+
+    /* in holds size bytes as written by seal(); out receives size - SEAL */
+    inline bool open( const uchar* prv, const uchar* pub, const uchar* in, ulong size, uchar* out ) noexcept {
+        uchar kek[ KEY ], nonce[ aead::NONCE ] = {0}; if( size < SEAL ){ return false; }
+        static thread_local aead_t aead;
+
+        bool done = derive( prv, in, in, pub, kek ) &&
+                    aead.open( kek, nonce, nullptr, 0, in + KEY, size - SEAL, out );
+        OPENSSL_cleanse( kek, KEY ); return done;
+    }
+
+    /*─······································································─*/
+
+    /* password protected private keys: LOCK bytes of salt, sealed key and
+       tag, under a PBKDF2-HMAC-SHA256 key */
+    inline bool stretch( const char* pass, ulong size, const uchar* salt, uchar* out ) noexcept {
+        return PKCS5_PBKDF2_HMAC( pass, (int) size, salt, SALT, ROUNDS, EVP_sha256(), KEY, out ) == 1;
+    }
+
+    inline bool lock( const char* pass, ulong size, const uchar* prv, uchar* out ) noexcept {
+        uchar kek[ KEY ], nonce[ aead::NONCE ] = {0}; aead_t aead;
+        bool done = aead::random( out, SALT ) && stretch( pass, size, out, kek ) &&
+                    aead.seal( kek, nonce, nullptr, 0, prv, KEY, out + SALT );
+        OPENSSL_cleanse( kek, KEY ); return done;
+    }
+
+    inline bool unlock( const char* pass, ulong size, const uchar* in, uchar* prv ) noexcept {
+        uchar kek[ KEY ], nonce[ aead::NONCE ] = {0}; aead_t aead;
+        bool done = stretch( pass, size, in, kek ) &&
+                    aead.open( kek, nonce, nullptr, 0, in + SALT, KEY, prv );
+        OPENSSL_cleanse( kek, KEY ); return done;
+    }
+
+}}}
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#endif
@@ -0,0 +1,189 @@
+/*
+ * Copyright 2023 The Nodepp Project Authors. All Rights Reserved.
+ *
+ * Licensed under the MIT (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://github.com/NodeppOficial/nodepp/blob/main/LICENSE
+ */
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#ifndef NODEPP_WPGP_FILE
+#define NODEPP_WPGP_FILE
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#include <nodepp/nodepp.h>
+#include <openssl/crypto.h>
+
+#include <cstdio>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <climits>
+#endif
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+/* Blocking, large block file I/O for file to file encryption. On linux
+   the source is mapped one window at a time with sequential readahead
+   hints, and pages already consumed are dropped from the page cache;
+   writes are vectored. Elsewhere, or when a file cannot be mapped, it
+   falls back to buffered stdio. */
+
+namespace nodepp { namespace wpgp { namespace file {
+
+    enum { BLOCK = 8388608 }; // plaintext bytes per window
+
+    struct piece_t { const char* ptr; ulong len; };
+
+    /*─······································································─*/
+
+    /* sequential reader: next( size ) returns the following size bytes,
+       valid until the next call */
+    class source_t {
+        ullong len = 0, pos = 0; std::vector<char> buff;
+    #ifdef __linux__
+        int fd = -1; char* map = nullptr; ulong mlen = 0; ullong moff = 0;
+
+        void unmap() noexcept { if( map == nullptr ){ return; } munmap( map, mlen );
+            posix_fadvise( fd, moff, mlen, POSIX_FADV_DONTNEED ); map = nullptr;
+        }
+    #else
+        FILE* fd = nullptr;
+    #endif
+    public:
+
+        source_t( const string_t& path ) noexcept {
+        #ifdef __linux__
+            fd = ::open( path.get(), O_RDONLY ); struct stat st;
+            if( fd < 0 || fstat( fd, &st ) != 0 || !S_ISREG( st.st_mode ) )
+              { if( fd >= 0 ){ ::close( fd ); } fd = -1; return; }
+            len = st.st_size; posix_fadvise( fd, 0, 0, POSIX_FADV_SEQUENTIAL );
+        #else
+            fd = fopen( path.get(), "rb" ); if( fd == nullptr ){ return; }
+        #ifdef _WIN32
+            _fseeki64( fd, 0, SEEK_END ); len = _ftelli64( fd ); _fseeki64( fd, 0, SEEK_SET );
+        #else
+            fseeko( fd, 0, SEEK_END ); len = ftello( fd ); fseeko( fd, 0, SEEK_SET );
+        #endif
+        #endif
+        }
+
+       ~source_t() noexcept { if( !buff.empty() ){ OPENSSL_cleanse( buff.data(), buff.size() ); }
+        #ifdef __linux__
+            unmap(); if( fd >= 0 ){ ::close( fd ); }
+        #else
+            if( fd != nullptr ){ fclose( fd ); }
+        #endif
+        }
+
+        source_t( const source_t& ) = delete; source_t& operator=( const source_t& ) = delete;
+
+        bool   is_open() const noexcept {
+        #ifdef __linux__
+            return fd >= 0;
+        #else
+            return fd != nullptr;
+        #endif
+        }
+
+        ullong size() const noexcept { return len; }
+
+        const char* next( ulong size ) noexcept {
+            if( !is_open() || size > len - pos ){ return nullptr; } if( size == 0 ){ return ""; }
+        #ifdef __linux__
+            unmap(); ullong page = sysconf( _SC_PAGESIZE ); moff = pos / page * page;
+            mlen = size + ( pos - moff ); void* ptr = mmap( nullptr, mlen, PROT_READ, MAP_PRIVATE, fd, moff );
+            if( ptr != MAP_FAILED ){ map = (char*) ptr; madvise( map, mlen, MADV_SEQUENTIAL );
+                madvise( map, mlen, MADV_WILLNEED );
+                const char* out = map + ( pos - moff ); pos += size; return out;
+            }
+            if( buff.size() < size ){ buff.resize( size ); }
+            for( ulong done=0; done<size; ){ ssize_t c = pread( fd, buff.data() + done, size - done, pos + done );
+                if( c <= 0 ){ return nullptr; } done += c;
+            }
+        #else
+            if( buff.size() < size ){ buff.resize( size ); }
+            if( fread( buff.data(), 1, size, fd ) != size ){ return nullptr; }
+        #endif
+            pos += size; return buff.data();
+        }
+    };
+
+    /*─······································································─*/
+
+    class sink_t {
+    #ifdef __linux__
+        int fd = -1;
+    #else
+        FILE* fd = nullptr;
+    #endif
+    public:
+
+        sink_t( const string_t& path ) noexcept {
+        #ifdef __linux__
+            fd = ::open( path.get(), O_WRONLY | O_CREAT | O_TRUNC, 0666 );
+        #else
+            fd = fopen( path.get(), "wb" );
+        #endif
+        }
+
+       ~sink_t() noexcept {
+        #ifdef __linux__
+            if( fd >= 0 ){ ::close( fd ); }
+        #else
+            if( fd != nullptr ){ fclose( fd ); }
+        #endif
+        }
+
+        sink_t( const sink_t& ) = delete; sink_t& operator=( const sink_t& ) = delete;
+
+        bool is_open() const noexcept {
+        #ifdef __linux__
+            return fd >= 0;
+        #else
+            return fd != nullptr;
+        #endif
+        }
+
+        /* writes every piece in order, with as few syscalls as possible */
+        bool write( const piece_t* list, ulong count ) noexcept {
+        #ifdef __linux__
+            std::vector<struct iovec> io; for( ulong x=0; x<count; x++ ){
+                if( list[x].len > 0 ){ io.push_back({ (void*) list[x].ptr, list[x].len }); }
+            }
+
+            for( ulong x=0; x<io.size(); ){
+                ssize_t c = writev( fd, io.data() + x, min( io.size() - x, (ulong) IOV_MAX ) );
+                if( c < 0 ){ return false; } ulong done = c;
+                while( x < io.size() && done >= io[x].iov_len ){ done -= io[x].iov_len; x++; }
+                if( done > 0 ){ io[x].iov_base = (char*) io[x].iov_base + done; io[x].iov_len -= done; }
+            }   return true;
+        #else
+            for( ulong x=0; x<count; x++ ){
+                if( fwrite( list[x].ptr, 1, list[x].len, fd ) != list[x].len ){ return false; }
+            }   return true;
+        #endif
+        }
+
+        bool close() noexcept {
+        #ifdef __linux__
+            int c = fd < 0 ? -1 : ::close( fd ); fd = -1; return c == 0;
+        #else
+            int c = fd == nullptr ? EOF : fclose( fd ); fd = nullptr; return c == 0;
+        #endif
+        }
+    };
+
+}}}
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#endif
@@ -0,0 +1,308 @@
+/*
+ * Copyright 2023 The Nodepp Project Authors. All Rights Reserved.
+ *
+ * Licensed under the MIT (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://github.com/NodeppOficial/nodepp/blob/main/LICENSE
+ */
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#ifndef NODEPP_WPGP_KERNEL
+#define NODEPP_WPGP_KERNEL
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#include <nodepp/nodepp.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+/* Fused XOR mask + base64 transform. encode() masks raw bytes and writes
+   standard padded base64, decode() reverses it; both work on caller
+   buffers and keep their position across calls, so a stream can be fed
+   in pieces of any size. The vector paths are picked at compile time
+   ( -mssse3 or -mavx2 ) and the scalar path handles everything else. */
+
+namespace nodepp { namespace wpgp { class kernel_t {
+protected:
+
+    enum { MASK = 8, EXT = 64 };
+
+    struct NODE {
+        uchar  ext[ EXT ]; // mask repeated, loaded at any phase
+        ulong  size=0;     // mask length
+        ulong  pos =0;     // raw bytes masked so far
+        uchar  tail[4];    // pending bytes or chars
+        ulong  tlen=0;
+        bool   done=0;     // padding seen
+    };  NODE obj;
+
+    static const char* table() noexcept {
+        return "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    }
+
+    static int value( uchar c ) noexcept {
+        static const struct LUT { signed char map[256]; LUT() noexcept {
+            memset( map, -1, sizeof( map ) );
+            for( int x=0; x<64; x++ ){ map[ (uchar) table()[x] ] = x; }
+        }}  lut; return lut.map[c];
+    }
+
+    uchar mask( ulong pos ) const noexcept {
+        return obj.size == 0 ? 0 : obj.ext[ pos % obj.size ];
+    }
+
+    const uchar* phase() const noexcept {
+        return obj.ext + ( obj.size == 0 ? 0 : obj.pos % obj.size );
+    }
+
+    /*─······································································─*/
+
+    void encode_quad( const uchar* in, char* out ) const noexcept {
+        out[0] = table()[ in[0] >> 2 ];
+        out[1] = table()[ ( ( in[0] & 0x03 ) << 4 ) | ( in[1] >> 4 ) ];
+        out[2] = table()[ ( ( in[1] & 0x0f ) << 2 ) | ( in[2] >> 6 ) ];
+        out[3] = table()[ in[2] & 0x3f ];
+    }
+
+    /* decodes one quad of chars into up to three bytes; returns the byte
+       count, or -1 when the quad is not valid base64 */
+    long decode_quad( const uchar* in, uchar* out ) noexcept {
+        int a = value( in[0] ), b = value( in[1] ), c = value( in[2] ), d = value( in[3] );
+        if( a < 0 || b < 0 ){ return -1; }
+
+        out[0] = ( a << 2 ) | ( b >> 4 ); if( c < 0 ){
+            if( in[2] != '=' || in[3] != '=' ){ return -1; } obj.done = 1; return 1;
+        }
+        out[1] = ( b << 4 ) | ( c >> 2 ); if( d < 0 ){
+            if( in[3] != '=' ){ return -1; } obj.done = 1; return 2;
+        }
+        out[2] = ( c << 6 ) | d; return 3;
+    }
+
+    /*─······································································─*/
+
+#if defined(__SSSE3__) || defined(__AVX2__)
+
+    static __m128i enc_lane( __m128i in ) noexcept {
+        in = _mm_shuffle_epi8( in, _mm_set_epi8( 10,11,9,10,7,8,6,7,4,5,3,4,1,2,0,1 ) );
+        __m128i t0 = _mm_mulhi_epu16( _mm_and_si128( in, _mm_set1_epi32( 0x0fc0fc00 ) ), _mm_set1_epi32( 0x04000040 ) );
+        __m128i t1 = _mm_mullo_epi16( _mm_and_si128( in, _mm_set1_epi32( 0x003f03f0 ) ), _mm_set1_epi32( 0x01000010 ) );
+        __m128i idx = _mm_or_si128( t0, t1 );
+
+        __m128i red = _mm_subs_epu8( idx, _mm_set1_epi8( 51 ) );
+        __m128i low = _mm_cmpgt_epi8( _mm_set1_epi8( 26 ), idx );
+        red = _mm_or_si128( red, _mm_and_si128( low, _mm_set1_epi8( 13 ) ) );
+        __m128i lut = _mm_setr_epi8( 'a'-26, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52,
+                                     '0'-52, '0'-52, '0'-52, '0'-52, '+'-62, '/'-63, 'A', 0, 0 );
+        return _mm_add_epi8( _mm_shuffle_epi8( lut, red ), idx );
+    }
+
+    /* returns false when the lane holds a char outside the alphabet */
+    static bool dec_lane( __m128i& in ) noexcept {
+        const __m128i m2f = _mm_set1_epi8( 0x2f );
+        __m128i lut_lo = _mm_setr_epi8( 0x15,0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x13,0x1a,0x1b,0x1b,0x1b,0x1a );
+        __m128i lut_hi = _mm_setr_epi8( 0x10,0x10,0x01,0x02,0x04,0x08,0x04,0x08,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10 );
+        __m128i lut_rl = _mm_setr_epi8( 0,16,19,4,-65,-65,-71,-71,0,0,0,0,0,0,0,0 );
+
+        __m128i hin = _mm_and_si128( _mm_srli_epi32( in, 4 ), m2f );
+        __m128i lo  = _mm_shuffle_epi8( lut_lo, _mm_and_si128( in, m2f ) );
+        __m128i hi  = _mm_shuffle_epi8( lut_hi, hin );
+        if( _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_and_si128( lo, hi ), _mm_setzero_si128() ) ) != 0xffff )
+          { return false; }
+
+        __m128i roll = _mm_shuffle_epi8( lut_rl, _mm_add_epi8( _mm_cmpeq_epi8( in, m2f ), hin ) );
+        in = _mm_add_epi8( in, roll );
+        in = _mm_maddubs_epi16( in, _mm_set1_epi32( 0x01400140 ) );
+        in = _mm_madd_epi16( in, _mm_set1_epi32( 0x00011000 ) );
+        in = _mm_shuffle_epi8( in, _mm_setr_epi8( 2,1,0,6,5,4,10,9,8,14,13,12,-1,-1,-1,-1 ) );
+        return true;
+    }
+
+#endif
+
+#if defined(__AVX2__)
+
+    static __m256i enc_lane( __m256i in ) noexcept {
+        in = _mm256_shuffle_epi8( in, _mm256_set_epi8( 10,11,9,10,7,8,6,7,4,5,3,4,1,2,0,1,
+                                                        10,11,9,10,7,8,6,7,4,5,3,4,1,2,0,1 ) );
+        __m256i t0 = _mm256_mulhi_epu16( _mm256_and_si256( in, _mm256_set1_epi32( 0x0fc0fc00 ) ), _mm256_set1_epi32( 0x04000040 ) );
+        __m256i t1 = _mm256_mullo_epi16( _mm256_and_si256( in, _mm256_set1_epi32( 0x003f03f0 ) ), _mm256_set1_epi32( 0x01000010 ) );
+        __m256i idx = _mm256_or_si256( t0, t1 );
+
+        __m256i red = _mm256_subs_epu8( idx, _mm256_set1_epi8( 51 ) );
+        __m256i low = _mm256_cmpgt_epi8( _mm256_set1_epi8( 26 ), idx );
+        red = _mm256_or_si256( red, _mm256_and_si256( low, _mm256_set1_epi8( 13 ) ) );
+        __m256i lut = _mm256_setr_epi8( 'a'-26, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52,
+                                        '0'-52, '0'-52, '0'-52, '0'-52, '+'-62, '/'-63, 'A', 0, 0,
+                                        'a'-26, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52,
+                                        '0'-52, '0'-52, '0'-52, '0'-52, '+'-62, '/'-63, 'A', 0, 0 );
+        return _mm256_add_epi8( _mm256_shuffle_epi8( lut, red ), idx );
+    }
+
+    static bool dec_lane( __m256i& in ) noexcept {
+        const __m256i m2f = _mm256_set1_epi8( 0x2f );
+        __m256i lut_lo = _mm256_setr_epi8( 0x15,0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x13,0x1a,0x1b,0x1b,0x1b,0x1a,
+                                           0x15,0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x13,0x1a,0x1b,0x1b,0x1b,0x1a );
+        __m256i lut_hi = _mm256_setr_epi8( 0x10,0x10,0x01,0x02,0x04,0x08,0x04,0x08,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,
+                                           0x10,0x10,0x01,0x02,0x04,0x08,0x04,0x08,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10 );
+        __m256i lut_rl = _mm256_setr_epi8( 0,16,19,4,-65,-65,-71,-71,0,0,0,0,0,0,0,0,
+                                           0,16,19,4,-65,-65,-71,-71,0,0,0,0,0,0,0,0 );
+
+        __m256i hin = _mm256_and_si256( _mm256_srli_epi32( in, 4 ), m2f );
+        __m256i lo  = _mm256_shuffle_epi8( lut_lo, _mm256_and_si256( in, m2f ) );
+        __m256i hi  = _mm256_shuffle_epi8( lut_hi, hin );
+        if( !_mm256_testz_si256( lo, hi ) ){ return false; }
+
+        __m256i roll = _mm256_shuffle_epi8( lut_rl, _mm256_add_epi8( _mm256_cmpeq_epi8( in, m2f ), hin ) );
+        in = _mm256_add_epi8( in, roll );
+        in = _mm256_maddubs_epi16( in, _mm256_set1_epi32( 0x01400140 ) );
+        in = _mm256_madd_epi16( in, _mm256_set1_epi32( 0x00011000 ) );
+        in = _mm256_shuffle_epi8( in, _mm256_setr_epi8( 2,1,0,6,5,4,10,9,8,14,13,12,-1,-1,-1,-1,
+                                                         2,1,0,6,5,4,10,9,8,14,13,12,-1,-1,-1,-1 ) );
+        return true;
+    }
+
+    /* masks of two consecutive 12 byte groups, one per lane */
+    __m256i phase2() const noexcept {
+        __m128i a = _mm_loadu_si128( (const __m128i*) phase() );
+        __m128i b = _mm_loadu_si128( (const __m128i*)( obj.ext + ( obj.size == 0 ? 0 : ( obj.pos + 12 ) % obj.size ) ) );
+        return _mm256_inserti128_si256( _mm256_castsi128_si256( a ), b, 1 );
+    }
+
+#endif
+
+    /* vector loops: encode reads 16 bytes per 12 it consumes and decode
+       writes 16 bytes per 12 it produces, so both stop early enough to
+       stay inside the caller buffers */
+
+    ulong encode_block( const uchar* in, ulong size, char* out ) noexcept { ulong pos = 0;
+    #if defined(__AVX2__)
+        while( size - pos >= 28 ){
+            __m256i a = _mm256_inserti128_si256( _mm256_castsi128_si256(
+                        _mm_loadu_si128( (const __m128i*)( in + pos ) ) ),
+                        _mm_loadu_si128( (const __m128i*)( in + pos + 12 ) ), 1 );
+            a = _mm256_xor_si256( a, phase2() ); obj.pos += 24;
+            _mm256_storeu_si256( (__m256i*)( out + pos / 3 * 4 ), enc_lane( a ) ); pos += 24;
+        }
+    #endif
+    #if defined(__SSSE3__) || defined(__AVX2__)
+        while( size - pos >= 16 ){
+            __m128i a = _mm_xor_si128( _mm_loadu_si128( (const __m128i*)( in + pos ) ), _mm_loadu_si128( (const __m128i*) phase() ) );
+            _mm_storeu_si128( (__m128i*)( out + pos / 3 * 4 ), enc_lane( a ) ); obj.pos += 12; pos += 12;
+        }
+    #endif
+        while( size - pos >= 3 ){ const uchar* msk = phase(); uchar raw[3];
+            ulong end = pos + min( ( size - pos ) / 3, 16ul ) * 3; obj.pos += end - pos;
+            for( ; pos < end; pos += 3, msk += 3 ){
+                raw[0] = in[pos] ^ msk[0]; raw[1] = in[pos+1] ^ msk[1]; raw[2] = in[pos+2] ^ msk[2];
+                encode_quad( raw, out + pos / 3 * 4 );
+            }
+        }   return pos;
+    }
+
+    long decode_block( const uchar* in, ulong size, uchar* out ) noexcept { ulong pos = 0, len = 0;
+    #if defined(__AVX2__)
+        while( size - pos >= 40 && !obj.done ){
+            __m256i a = _mm256_loadu_si256( (const __m256i*)( in + pos ) ); if( !dec_lane( a ) ){ break; }
+            a = _mm256_xor_si256( a, phase2() );
+            _mm_storeu_si128( (__m128i*)( out + len ), _mm256_castsi256_si128( a ) );
+            _mm_storeu_si128( (__m128i*)( out + len + 12 ), _mm256_extracti128_si256( a, 1 ) );
+            obj.pos += 24; pos += 32; len += 24;
+        }
+    #endif
+    #if defined(__SSSE3__) || defined(__AVX2__)
+        while( size - pos >= 24 && !obj.done ){
+            __m128i a = _mm_loadu_si128( (const __m128i*)( in + pos ) ); if( !dec_lane( a ) ){ break; }
+            a = _mm_xor_si128( a, _mm_loadu_si128( (const __m128i*) phase() ) );
+            _mm_storeu_si128( (__m128i*)( out + len ), a ); obj.pos += 12; pos += 16; len += 12;
+        }
+    #endif
+        while( size - pos >= 4 ){ if( obj.done ){ return -1; }
+            long n = decode_quad( in + pos, out + len ); if( n < 0 ){ return -1; }
+            const uchar* msk = phase(); obj.pos += n;
+            for( long x=0; x<n; x++ ){ out[ len + x ] ^= msk[x]; }
+            pos += 4; len += n;
+        }   return size == pos ? (long) len : -1;
+    }
+
+public:
+
+    kernel_t() noexcept { set_mask( nullptr, 0 ); }
+
+    kernel_t( const char* key, ulong size ) noexcept { set_mask( key, size ); }
+
+    /*─······································································─*/
+
+    void set_mask( const char* key, ulong size ) noexcept {
+        obj.size = size > MASK ? (ulong) MASK : size; memset( obj.ext, 0, EXT );
+        if( obj.size > 0 ){ for( ulong x=0; x<EXT; x++ ){ obj.ext[x] = key[ x % obj.size ]; } }
+        reset();
+    }
+
+    void reset() noexcept { obj.pos = 0; obj.tlen = 0; obj.done = 0; }
+
+    /*─······································································─*/
+
+    /* output of the next encode() call, and an upper bound of the output
+       of the next decode() call, when fed size more bytes */
+    ulong encode_size( ulong size, bool last ) const noexcept {
+        return ( obj.tlen + size + ( last ? 2 : 0 ) ) / 3 * 4;
+    }
+
+    ulong decode_size( ulong size ) const noexcept { return ( obj.tlen + size + 3 ) / 4 * 3; }
+
+    /*─······································································─*/
+
+    /* masks and encodes size bytes of in into out; bytes that do not fill
+       a quad wait for the next call, or are padded when last is set */
+    ulong encode( const char* in, ulong size, char* out, bool last ) noexcept {
+        auto  src = (const uchar*) in; ulong len = 0;
+
+        while( obj.tlen > 0 && obj.tlen < 3 && size > 0 ){
+            obj.tail[ obj.tlen++ ] = *src++ ^ mask( obj.pos++ ); size--;
+        }
+
+        if( obj.tlen == 3 ){ encode_quad( obj.tail, out ); len += 4; obj.tlen = 0; }
+
+        ulong pos = encode_block( src, size, out + len ); len += pos / 3 * 4;
+        while( pos < size ){ obj.tail[ obj.tlen++ ] = src[ pos++ ] ^ mask( obj.pos++ ); }
+
+        if( last && obj.tlen > 0 ){
+            memset( obj.tail + obj.tlen, 0, 3 - obj.tlen ); encode_quad( obj.tail, out + len );
+            if( obj.tlen == 1 ){ out[ len + 2 ] = '='; } out[ len + 3 ] = '='; len += 4;
+        }   if( last ){ reset(); } return len;
+    }
+
+    /* decodes size chars of in and unmasks them into out; returns the
+       byte count or -1 when the input is not valid padded base64 */
+    long decode( const char* in, ulong size, char* out, bool last ) noexcept {
+        auto  src = (const uchar*) in; auto dst = (uchar*) out; long len = 0;
+
+        while( obj.tlen > 0 && obj.tlen < 4 && size > 0 ){ obj.tail[ obj.tlen++ ] = *src++; size--; }
+
+        if( obj.tlen == 4 ){ obj.tlen = 0; if( obj.done ){ return -1; }
+            long n = decode_quad( obj.tail, dst ); if( n < 0 ){ return -1; }
+            for( long x=0; x<n; x++ ){ dst[x] ^= mask( obj.pos++ ); } len += n;
+        }
+
+        ulong body = size / 4 * 4;
+        long  n = decode_block( src, body, dst + len ); if( n < 0 ){ return -1; } len += n;
+        while( body < size ){ obj.tail[ obj.tlen++ ] = src[ body++ ]; }
+
+        if( last ){ bool valid = obj.tlen == 0; reset(); if( !valid ){ return -1; } }
+        return len;
+    }
+
+};}}
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#endif
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2023 The Nodepp Project Authors. All Rights Reserved.
+ *
+ * Licensed under the MIT (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://github.com/NodeppOficial/nodepp/blob/main/LICENSE
+ */
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#ifndef NODEPP_WPGP_KEY
+#define NODEPP_WPGP_KEY
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#include "wpgp.h"
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+/* A read only handle on a parsed key, meant to be shared by many sessions.
+   Copies hold a single pointer: the handle takes a snapshot of the key
+   and its settings when it is built, and errors reach the events of the
+   wpgp_t it was taken from. The handle exposes no setters, and later
+   changes to that wpgp_t do not reach it, so sessions cannot change the
+   key under each other. */
+
+namespace nodepp { class wpgp_key_t {
+protected:
+
+    ptr_t<wpgp_t> obj;
+
+public:
+
+    wpgp_key_t( const wpgp_t& pgp ) noexcept : obj( new wpgp_t( pgp.snapshot() ) ) {}
+
+    /*─······································································─*/
+
+    string_t get_name()        const noexcept { return obj->get_name(); }
+    string_t get_mail()        const noexcept { return obj->get_mail(); }
+    string_t get_fingerprint() const noexcept { return obj->get_fingerprint(); }
+    string_t get_format()      const noexcept { return obj->get_format(); }
+    ulong    get_size()        const noexcept { return obj->get_size(); }
+    bool     is_binary()       const noexcept { return obj->get_format() == "WPGB"; }
+
+    /*─······································································─*/
+
+    string_t encrypt_message( const string_t& msg ) const noexcept { return obj->encrypt_message( msg ); }
+    string_t decrypt_message( const string_t& msg ) const noexcept { return obj->decrypt_message( msg ); }
+
+    string_t sign( const string_t& msg ) const noexcept { return obj->sign( msg ); }
+    bool verify( const string_t& msg, const string_t& sig ) const noexcept { return obj->verify( msg, sig ); }
+
+};}
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#endif
@@ -0,0 +1,140 @@
+/*
+ * Copyright 2023 The Nodepp Project Authors. All Rights Reserved.
+ *
+ * Licensed under the MIT (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://github.com/NodeppOficial/nodepp/blob/main/LICENSE
+ */
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#ifndef NODEPP_WPGP_KEYGEN
+#define NODEPP_WPGP_KEYGEN
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#include "pool.h"
+#include "stats.h"
+
+#include <openssl/evp.h>
+#include <openssl/rsa.h>
+#include <openssl/pem.h>
+
+#include <string>
+#include <memory>
+#include <map>
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+/* RSA keys are generated on the worker pool as PEM text in plain
+   std::string buffers; the event loop turns them into rsa_t objects. */
+
+namespace nodepp { namespace wpgp { namespace keygen {
+
+    inline void clear( std::string& pem ) noexcept {
+        if( !pem.empty() ){ OPENSSL_cleanse( &pem[0], pem.size() ); } pem.clear();
+    }
+
+    /* flags polled while primes are searched; keygen fails as soon as
+       any of them is set */
+    struct cancel_t { const std::atomic<bool>* flag[2] = { nullptr, nullptr }; };
+
+    inline int progress( EVP_PKEY_CTX* ctx ) noexcept {
+        auto cancel = (const cancel_t*) EVP_PKEY_CTX_get_app_data( ctx );
+        for( auto x : cancel->flag ){ if( x != nullptr && x->load() ){ return 0; } } return 1;
+    }
+
+    /* generates a size bit RSA private key as PEM; safe to call off the event loop */
+    inline bool generate( ulong size, std::string& pem, const cancel_t* cancel=nullptr ) noexcept {
+        EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id( EVP_PKEY_RSA, nullptr ); WPGP_STAGE( KEYGEN, size );
+        EVP_PKEY*     key = nullptr; BIO* bio = nullptr; bool done = false;
+
+        if( ctx != nullptr && cancel != nullptr ){
+            EVP_PKEY_CTX_set_app_data( ctx, (void*) cancel ); EVP_PKEY_CTX_set_cb( ctx, progress );
+        }
+
+        do { if( ctx == nullptr || EVP_PKEY_keygen_init( ctx ) <= 0 ||
+                 EVP_PKEY_CTX_set_rsa_keygen_bits( ctx, (int) size ) <= 0 ||
+                 EVP_PKEY_keygen( ctx, &key ) <= 0 ){ break; }
+
+             bio = BIO_new( BIO_s_mem() ); if( bio == nullptr ){ break; }
+             if( PEM_write_bio_PrivateKey_traditional( bio, key, nullptr, nullptr, 0, nullptr, nullptr ) <= 0 ){ break; }
+
+             char* data = nullptr; long len = BIO_get_mem_data( bio, &data );
+             if( len > 0 ){ pem.assign( data, len ); done = true; }
+        } while(0);
+
+        if( bio != nullptr ){ BIO_free( bio ); }
+        if( key != nullptr ){ EVP_PKEY_free( key ); }
+        if( ctx != nullptr ){ EVP_PKEY_CTX_free( ctx ); }
+        return done;
+    }
+
+    /*─······································································─*/
+
+    /* Background key pool: keeps `count` keys of every reserved size
+       generated ahead of time so new users can be issued instantly. */
+
+    /* Refills in flight give up when the pool shuts down, or when their
+       slot is cut below what is already queued; each slot's cancel flag
+       is replaced once raised, so later refills start clean. */
+    struct store_t {
+        struct SLOT {
+            std::deque<std::string> keys; ulong want=0, busy=0;
+            std::shared_ptr<std::atomic<bool>> cancel = std::make_shared<std::atomic<bool>>( false );
+        };
+        std::map<ulong,SLOT> slot; std::mutex mtx;
+       ~store_t() noexcept { for( auto& x : slot ){ for( auto& y : x.second.keys ){ clear( y ); } } }
+    };
+
+    /* shared with the refill tasks, which may outlive the static */
+    inline std::shared_ptr<store_t> store() noexcept {
+        static auto store = std::make_shared<store_t>(); return store;
+    }
+
+    inline void refill( ulong size ) noexcept {
+        auto st = store(); std::unique_lock<std::mutex> lock( st->mtx );
+        auto& sl = st->slot[ size ]; auto stop = &pool::get().stopped();
+
+        while( sl.keys.size() + sl.busy < sl.want ){ sl.busy++; auto flag = sl.cancel; pool::get().push([=](){
+            std::string pem; cancel_t cancel; cancel.flag[0] = stop; cancel.flag[1] = flag.get();
+            bool done = !flag->load() && generate( size, pem, &cancel );
+            do { std::unique_lock<std::mutex> lock( st->mtx );
+                 auto& sl = st->slot[ size ]; sl.busy--;
+                 if( done && sl.keys.size() < sl.want ){ sl.keys.push_back( std::move( pem ) ); }
+            } while(0); clear( pem ); if( ( done || flag->load() ) && !stop->load() ){ refill( size ); }
+        }); }
+    }
+
+    /* keeps count keys of size bits ready; a count of 0 drops the reserve
+       and cancels the keys still being generated for it */
+    inline void reserve( ulong size, ulong count ) noexcept {
+        do { auto st = store(); std::unique_lock<std::mutex> lock( st->mtx );
+             auto& sl = st->slot[ size ]; sl.want = count;
+             while( sl.keys.size() > count ){ clear( sl.keys.back() ); sl.keys.pop_back(); }
+             if( sl.busy > 0 && sl.keys.size() + sl.busy > count ){ sl.cancel->store( true );
+                 sl.cancel = std::make_shared<std::atomic<bool>>( false );
+             }
+        } while(0); refill( size );
+    }
+
+    inline ulong available( ulong size ) noexcept {
+        auto st = store(); std::unique_lock<std::mutex> lock( st->mtx );
+        auto it = st->slot.find( size ); return it == st->slot.end() ? 0 : it->second.keys.size();
+    }
+
+    /* pops a pre-generated key of size bits, if any, and schedules its replacement */
+    inline bool take( ulong size, std::string& pem ) noexcept {
+        do { auto st = store(); std::unique_lock<std::mutex> lock( st->mtx );
+             auto it = st->slot.find( size );
+             if( it == st->slot.end() || it->second.keys.empty() ){ return false; }
+             pem = std::move( it->second.keys.front() ); it->second.keys.pop_front();
+        } while(0); refill( size ); return true;
+    }
+
+}}}
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#endif
@@ -0,0 +1,243 @@
+/*
+ * Copyright 2023 The Nodepp Project Authors. All Rights Reserved.
+ *
+ * Licensed under the MIT (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://github.com/NodeppOficial/nodepp/blob/main/LICENSE
+ */
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#ifndef NODEPP_WPGP_KEYRING
+#define NODEPP_WPGP_KEYRING
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#include "wpgp.h"
+#include "lru.h"
+
+#include <cstdio>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+/* A keyring file is laid out as
+     "WPGR" | version u32 | count u32 | slots u32 | fprt table u64 | mail table u64
+     records: key len u32 | mail len u16 | fingerprint[64] | mail | key
+     two open addressing tables of slots entries: hash u64 | record u64
+   with every integer big endian. A record offset of 0 marks an empty slot. */
+
+namespace nodepp { class wpgp_keyring_t {
+protected:
+
+    enum { HEAD = 32, FPRT = 64, SLOT = 16, RECORD = 6 + FPRT, VERSION = 1 };
+
+    struct NODE {
+        const uchar* data = nullptr;
+        ulong        size = 0;
+        ulong       count = 0;
+        ulong       slots = 0;
+        ulong      table[2];
+        wpgp::lru_t<wpgp_t> cache;
+    #ifdef _WIN32
+        HANDLE fd=INVALID_HANDLE_VALUE, map=nullptr;
+    #else
+        int    fd=-1;
+    #endif
+    };  ptr_t<NODE> obj;
+
+    /*─······································································─*/
+
+    static ulong get_uint( const uchar* raw, ulong size ) noexcept { ulong value = 0;
+        for( ulong x=0; x<size; x++ ){ value = ( value << 8 ) | raw[x]; } return value;
+    }
+
+    static void set_uint( uchar* raw, ulong value, ulong size ) noexcept {
+        for( ulong x=size; x-->0; ){ raw[x] = value & 0xff; value >>= 8; }
+    }
+
+    static ullong hash( const string_t& key ) noexcept { uchar out[32];
+        wpgp::aead::digest( key.get(), key.size(), out );
+        ullong value = wpgp::aead::get_uint64( out ); return value == 0 ? 1 : value;
+    }
+
+    /*─······································································─*/
+
+    /* walks the probe sequence of table for key and calls fn( record )
+       on every candidate until fn returns true */
+    template< class T >
+    ulong lookup( ulong table, ullong key, T fn ) const noexcept {
+        if( obj->data == nullptr || obj->slots == 0 ){ return 0; }
+        for( ulong x=0; x<obj->slots; x++ ){
+            const uchar* slot = obj->data + obj->table[table] + ( ( key + x ) & ( obj->slots - 1 ) ) * SLOT;
+            ulong rec = get_uint( slot + 8, 8 ); if( rec == 0 ){ return 0; }
+            if( wpgp::aead::get_uint64( slot ) == key && fn( rec ) ){ return rec; }
+        }   return 0;
+    }
+
+    bool check( ulong rec ) const noexcept {
+        if( rec < HEAD || rec > obj->size || obj->size - rec < RECORD ){ return false; }
+        ulong klen = get_uint( obj->data + rec, 4 ), mlen = get_uint( obj->data + rec + 4, 2 );
+        return obj->size - rec - RECORD >= klen + mlen;
+    }
+
+    string_t get_fprt( ulong rec ) const noexcept {
+        return string_t( (char*) obj->data + rec + 6, FPRT );
+    }
+
+    string_t get_mail( ulong rec ) const noexcept {
+        return string_t( (char*) obj->data + rec + RECORD, get_uint( obj->data + rec + 4, 2 ) );
+    }
+
+    /* a record whose key fails to parse, has expired or does not match
+       its fingerprint is reported on the keyring and never cached */
+    wpgp_t load( ulong rec ) const noexcept {
+        auto item = obj->cache.get( rec ); if( item != nullptr ){ return *item; } wpgp_t pgp;
+
+        ulong klen = get_uint( obj->data + rec, 4 ), mlen = get_uint( obj->data + rec + 4, 2 );
+        try { pgp.read_public_key_from_memory( string_t( (char*) obj->data + rec + RECORD + mlen, klen ) ); }
+        catch(...) { WPGP_ERROR( onError, "Invalid WPGP Key" ); return wpgp_t(); }
+
+        if( pgp.get_fingerprint() != get_fprt( rec ) )
+          { WPGP_ERROR( onError, "Invalid WPGP Key" ); return wpgp_t(); }
+
+        obj->cache.set( rec, pgp ); return pgp;
+    }
+
+public:
+
+    event_t<except_t> onError;
+
+    /*─······································································─*/
+
+    wpgp_keyring_t( const string_t& path, ulong cache=1024 ) : obj( new NODE() ) {
+        obj->cache = wpgp::lru_t<wpgp_t>( cache );
+
+    #ifdef _WIN32
+        obj->fd = CreateFileA( path.get(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+        if( obj->fd == INVALID_HANDLE_VALUE ){ throw except_t( "Invalid WPGP keyring" ); }
+        LARGE_INTEGER len; GetFileSizeEx( obj->fd, &len ); obj->size = len.QuadPart;
+        obj->map  = CreateFileMappingA( obj->fd, nullptr, PAGE_READONLY, 0, 0, nullptr );
+        obj->data = obj->map==nullptr ? nullptr : (const uchar*) MapViewOfFile( obj->map, FILE_MAP_READ, 0, 0, 0 );
+    #else
+        obj->fd = ::open( path.get(), O_RDONLY ); struct stat st;
+        if( obj->fd < 0 || fstat( obj->fd, &st ) != 0 ){ free(); throw except_t( "Invalid WPGP keyring" ); }
+        obj->size = st.st_size; void* map = obj->size < HEAD ? MAP_FAILED :
+                    mmap( nullptr, obj->size, PROT_READ, MAP_SHARED, obj->fd, 0 );
+        obj->data = map == MAP_FAILED ? nullptr : (const uchar*) map;
+    #endif
+
+        if( obj->data == nullptr || obj->size < HEAD || memcmp( obj->data, "WPGR", 4 ) != 0 ||
+            get_uint( obj->data + 4, 4 ) != VERSION ){ free(); throw except_t( "Invalid WPGP keyring" ); }
+
+        obj->count    = get_uint( obj->data + 8 , 4 );
+        obj->slots    = get_uint( obj->data + 12, 4 );
+        obj->table[0] = get_uint( obj->data + 16, 8 );
+        obj->table[1] = get_uint( obj->data + 24, 8 );
+
+        for( auto x : obj->table ){
+        if ( ( obj->slots & ( obj->slots - 1 ) ) != 0 || x < HEAD || x > obj->size ||
+             ( obj->size - x ) / SLOT < obj->slots ){ free(); throw except_t( "Invalid WPGP keyring" ); }
+        }
+    }
+
+   ~wpgp_keyring_t() noexcept { if( obj.count() > 1 ){ return; } free(); }
+
+    /*─······································································─*/
+
+    ulong size() const noexcept { return obj->count; }
+
+    bool has( const string_t& fprt ) const noexcept {
+        return lookup( 0, hash( fprt ), [&]( ulong rec ){
+            return check( rec ) && get_fprt( rec ) == fprt;
+        }) != 0;
+    }
+
+    bool has_mail( const string_t& mail ) const noexcept {
+        return lookup( 1, hash( mail ), [&]( ulong rec ){
+            return check( rec ) && get_mail( rec ) == mail;
+        }) != 0;
+    }
+
+    /*─······································································─*/
+
+    /* keys are parsed on first use and kept in a bounded LRU cache */
+    wpgp_t get( const string_t& fprt ) const noexcept {
+        ulong rec = lookup( 0, hash( fprt ), [&]( ulong rec ){
+            return check( rec ) && get_fprt( rec ) == fprt;
+        }); if( rec == 0 ){ WPGP_ERROR( onError, "Invalid WPGP Key" ); return wpgp_t(); }
+        return load( rec );
+    }
+
+    wpgp_t get_by_mail( const string_t& mail ) const noexcept {
+        ulong rec = lookup( 1, hash( mail ), [&]( ulong rec ){
+            return check( rec ) && get_mail( rec ) == mail;
+        }); if( rec == 0 ){ WPGP_ERROR( onError, "Invalid WPGP Key" ); return wpgp_t(); }
+        return load( rec );
+    }
+
+    /*─······································································─*/
+
+    static void write( const string_t& path, const array_t<wpgp_t>& list ) {
+        ulong slots = 1; while( slots < list.size() * 2 ){ slots <<= 1; }
+        std::vector<uchar> table ( slots * SLOT * 2, 0 ); ulong pos = HEAD;
+
+        FILE* file = fopen( path.get(), "wb" ); uchar head[ HEAD ] = { 'W','P','G','R' };
+        if( file == nullptr ){ throw except_t( "Invalid WPGP keyring" ); }
+        fwrite( head, 1, HEAD, file );
+
+        for( auto& x : list ){
+            auto fprt = x.get_fingerprint(), mail = x.get_mail(), key = x.write_public_key_to_memory();
+            if( fprt.size() != FPRT || mail.size() > 0xffff ){ fclose( file ); throw except_t( "Invalid WPGP Key" ); }
+
+            uchar rec[6]; set_uint( rec, key.size(), 4 ); set_uint( rec + 4, mail.size(), 2 );
+            fwrite( rec, 1, 6, file ); fwrite( fprt.get(), 1, FPRT, file );
+            fwrite( mail.get(), 1, mail.size(), file ); fwrite( key.get(), 1, key.size(), file );
+
+            ullong id[2] = { hash( fprt ), hash( mail ) };
+            for( ulong y=0; y<2; y++ ){ for( ulong z=0; z<slots; z++ ){
+                uchar* slot = table.data() + y * slots * SLOT + ( ( id[y] + z ) & ( slots - 1 ) ) * SLOT;
+                if( get_uint( slot + 8, 8 ) != 0 ){ continue; }
+                wpgp::aead::set_uint64( slot, id[y] ); set_uint( slot + 8, pos, 8 ); break;
+            }}  pos += RECORD + mail.size() + key.size();
+        }
+
+        set_uint( head + 4 , VERSION, 4 ); set_uint( head + 8 , list.size(), 4 );
+        set_uint( head + 12, slots, 4 ); set_uint( head + 16, pos, 8 );
+        set_uint( head + 24, pos + slots * SLOT, 8 );
+
+        fwrite( table.data(), 1, slots * SLOT * 2, file );
+        fseek ( file, 0, SEEK_SET ); fwrite( head, 1, HEAD, file );
+        if( fclose( file ) != 0 ){ throw except_t( "Invalid WPGP keyring" ); }
+    }
+
+    /*─······································································─*/
+
+    void free() const noexcept { obj->cache.clear();
+    #ifdef _WIN32
+        if( obj->data != nullptr ){ UnmapViewOfFile( obj->data ); }
+        if( obj->map  != nullptr ){ CloseHandle( obj->map ); }
+        if( obj->fd   != INVALID_HANDLE_VALUE ){ CloseHandle( obj->fd ); }
+        obj->map = nullptr; obj->fd = INVALID_HANDLE_VALUE;
+    #else
+        if( obj->data != nullptr ){ munmap( (void*) obj->data, obj->size ); }
+        if( obj->fd   >= 0 ){ ::close( obj->fd ); } obj->fd = -1;
+    #endif
+        obj->data = nullptr; obj->size = 0; obj->slots = 0;
+    }
+
+};}
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#endif
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2023 The Nodepp Project Authors. All Rights Reserved.
+ *
+ * Licensed under the MIT (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://github.com/NodeppOficial/nodepp/blob/main/LICENSE
+ */
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#ifndef NODEPP_WPGP_LRU
+#define NODEPP_WPGP_LRU
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#include <nodepp/nodepp.h>
+
+#include <unordered_map>
+#include <utility>
+#include <list>
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+namespace nodepp { namespace wpgp { template< class V > class lru_t {
+protected:
+
+    using ITEM = std::pair<ullong,V>;
+    using LIST = typename std::list<ITEM>;
+    using DROP = void (*)( V& );
+
+    struct NODE {
+        std::unordered_map<ullong,typename LIST::iterator> map;
+        LIST  list; ulong size=0; DROP drop=nullptr;
+       ~NODE() noexcept { if( drop == nullptr ){ return; } for( auto& x : list ){ drop( x.second ); } }
+    };  ptr_t<NODE> obj;
+
+public:
+
+    /* drop, when set, sees every value right before the cache lets go of
+       it: on eviction, erase, replacement, clear and destruction */
+    lru_t( ulong size=1024, DROP drop=nullptr ) noexcept : obj( new NODE() ) { obj->size = size; obj->drop = drop; }
+
+    /*─······································································─*/
+
+    ulong size()     const noexcept { return obj->list.size(); }
+    ulong capacity() const noexcept { return obj->size; }
+    bool  empty()    const noexcept { return obj->list.empty(); }
+
+    /*─······································································─*/
+
+    /* returns the cached value and marks it as the most recently used one,
+       or nullptr when key is not cached */
+    V* get( ullong key ) const noexcept {
+        auto x = obj->map.find( key ); if( x == obj->map.end() ){ return nullptr; }
+        obj->list.splice( obj->list.begin(), obj->list, x->second );
+        return &x->second->second;
+    }
+
+    /* inserts or replaces key; the least recently used entry is dropped
+       once the cache is full */
+    V* set( ullong key, const V& value ) const noexcept {
+        if( obj->size == 0 ){ return nullptr; }
+        auto x = obj->map.find( key ); if( x != obj->map.end() ){
+            if( obj->drop != nullptr ){ obj->drop( x->second->second ); }
+            x->second->second = value; return get( key );
+        }   while( obj->list.size() >= obj->size ){ pop(); }
+        obj->list.emplace_front( key, value ); obj->map[key] = obj->list.begin();
+        return &obj->list.front().second;
+    }
+
+    void erase( ullong key ) const noexcept {
+        auto x = obj->map.find( key ); if( x == obj->map.end() ){ return; }
+        if( obj->drop != nullptr ){ obj->drop( x->second->second ); }
+        obj->list.erase( x->second ); obj->map.erase( x );
+    }
+
+    void pop() const noexcept { if( obj->list.empty() ){ return; }
+        if( obj->drop != nullptr ){ obj->drop( obj->list.back().second ); }
+        obj->map.erase( obj->list.back().first ); obj->list.pop_back();
+    }
+
+    void clear() const noexcept {
+        if( obj->drop != nullptr ){ for( auto& x : obj->list ){ obj->drop( x.second ); } }
+        obj->map.clear(); obj->list.clear();
+    }
+
+};}}
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#endif
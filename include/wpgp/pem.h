@@ -0,0 +1,68 @@
+/*
+ * Copyright 2023 The Nodepp Project Authors. All Rights Reserved.
+ *
+ * Licensed under the MIT (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://github.com/NodeppOficial/nodepp/blob/main/LICENSE
+ */
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#ifndef NODEPP_WPGP_PEM
+#define NODEPP_WPGP_PEM
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#include <nodepp/nodepp.h>
+#include <openssl/evp.h>
+
+#include <string>
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+/* Conversion between a single PEM block and its label plus DER bytes,
+   used by the binary key container. */
+
+namespace nodepp { namespace wpgp { namespace pem {
+
+    /* blocks with headers, such as password protected keys, are refused
+       since DER alone cannot carry them */
+    inline bool to_der( const string_t& pem, string_t& label, string_t& der ) noexcept {
+        std::string text( pem.get(), pem.size() ), body;
+        if( text.compare( 0, 11, "-----BEGIN " ) != 0 ){ return false; }
+
+        auto head = text.find( "-----", 11 ); if( head == std::string::npos || head - 11 > 255 ){ return false; }
+        auto name = text.substr( 11, head - 11 );
+        auto tail = text.find( "-----END " + name + "-----", head ); if( tail == std::string::npos ){ return false; }
+
+        for( ulong x=head+5; x<tail; x++ ){ char c = text[x];
+            if( c == ':' ){ return false; }
+            if( c != '\n' && c != '\r' && c != ' ' && c != '\t' ){ body += c; }
+        }   if( body.empty() || body.size() % 4 != 0 ){ return false; }
+
+        std::string out( body.size() / 4 * 3, '\0' );
+        int len = EVP_DecodeBlock( (uchar*) &out[0], (const uchar*) body.data(), body.size() );
+        if( len < 0 ){ return false; } len -= ( body[ body.size()-1 ] == '=' ) + ( body[ body.size()-2 ] == '=' );
+
+        label = string_t( name.data(), name.size() ); der = string_t( out.data(), len ); return true;
+    }
+
+    inline string_t from_der( const string_t& label, const string_t& der ) noexcept {
+        std::string name( label.get(), label.size() ), out; uchar buf[ 65 ];
+        out.reserve( der.size() * 4 / 3 + der.size() / 48 + name.size() * 2 + 40 );
+        out += "-----BEGIN " + name + "-----\n";
+
+        for( ulong x=0; x<der.size(); x+=48 ){
+            int len = EVP_EncodeBlock( buf, (const uchar*) der.get() + x, (int) min( 48ul, der.size() - x ) );
+            out.append( (char*) buf, len ); out += '\n';
+        }
+
+        out += "-----END " + name + "-----\n"; return string_t( out.data(), out.size() );
+    }
+
+}}}
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#endif
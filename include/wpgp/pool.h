@@ -0,0 +1,164 @@
+/*
+ * Copyright 2023 The Nodepp Project Authors. All Rights Reserved.
+ *
+ * Licensed under the MIT (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://github.com/NodeppOficial/nodepp/blob/main/LICENSE
+ */
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#ifndef NODEPP_WPGP_POOL
+#define NODEPP_WPGP_POOL
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#include <nodepp/nodepp.h>
+
+#include <condition_variable>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <map>
+#include <deque>
+#include <mutex>
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+/* Worker threads never touch nodepp's reference-counted objects that the
+   event loop can reach: tasks receive raw pointers into buffers, or into
+   a private snapshot, that the event loop keeps alive. */
+
+namespace nodepp { namespace wpgp { class pool_t {
+protected:
+
+    struct NODE {
+        std::deque<std::function<void()>> queue;
+        std::vector<std::thread>          thread;
+        std::condition_variable           cond;
+        std::mutex                        mtx;
+        std::atomic<bool>                 stop{false};
+    };  NODE* obj;
+
+    /* once stopped, workers finish the task at hand and drop the rest */
+    static void worker( NODE* obj ) noexcept { while( true ){
+        std::function<void()> task; do {
+            std::unique_lock<std::mutex> lock( obj->mtx );
+            obj->cond.wait( lock, [=](){ return obj->stop || !obj->queue.empty(); });
+            if( obj->stop ){ return; }
+            task = std::move( obj->queue.front() ); obj->queue.pop_front();
+        } while(0); task();
+    }}
+
+public:
+
+    pool_t( ulong size=0 ) noexcept : obj( new NODE() ) {
+        if( size == 0 ){ size = std::thread::hardware_concurrency(); }
+        if( size == 0 ){ size = 1; }
+        for( ulong x=0; x<size; x++ ){ obj->thread.emplace_back( worker, obj ); }
+    }
+
+   ~pool_t() noexcept {
+        do { std::unique_lock<std::mutex> lock( obj->mtx ); obj->stop = 1; } while(0);
+        obj->cond.notify_all(); for( auto& x : obj->thread ){ x.join(); }
+        obj->queue.clear(); delete obj;
+    }
+
+    pool_t( const pool_t& ) = delete; pool_t& operator=( const pool_t& ) = delete;
+
+    /*─······································································─*/
+
+    ulong size() const noexcept { return obj->thread.size(); }
+
+    /* set when the pool shuts down; stays readable until every worker
+       has returned, so long tasks may poll it to give up early */
+    const std::atomic<bool>& stopped() const noexcept { return obj->stop; }
+
+    void push( std::function<void()> task ) const noexcept {
+        do { std::unique_lock<std::mutex> lock( obj->mtx );
+             obj->queue.push_back( std::move( task ) );
+        } while(0); obj->cond.notify_one();
+    }
+
+    /*─······································································─*/
+
+    /* Runs fn( x ) for every x in [0,count) and returns once all of them
+       finished; the calling thread takes work items too, so run() may be
+       nested inside tasks that already occupy every worker. */
+    template< class T >
+    void run( ulong count, const T& fn ) const noexcept {
+        if( count == 0 ){ return; } if( count == 1 || size() == 1 ){
+            for( ulong x=0; x<count; x++ ){ fn( x ); } return;
+        }
+
+        struct STATE {
+            std::atomic<ulong> next{0}, done{0};
+            std::condition_variable cond; std::mutex mtx;
+        };  auto state = std::make_shared<STATE>(); const T* func = &fn;
+
+        /* helpers that start after every item was claimed never touch func */
+        auto loop = [state,func,count](){ ulong x;
+            while( ( x = state->next.fetch_add( 1 ) ) < count ){ (*func)( x );
+                if( state->done.fetch_add( 1 ) + 1 == count ){
+                    std::unique_lock<std::mutex> lock( state->mtx ); state->cond.notify_all();
+                }
+            }
+        };
+
+        ulong helpers = count-1 < size() ? count-1 : size();
+        for( ulong x=0; x<helpers; x++ ){ push( loop ); }
+
+        loop(); std::unique_lock<std::mutex> lock( state->mtx );
+        state->cond.wait( lock, [&](){ return state->done == count; });
+    }
+
+};}}
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+namespace nodepp { namespace wpgp { namespace pool {
+
+    inline const pool_t& get() noexcept { static pool_t pool; return pool; }
+
+    /*─······································································─*/
+
+    /* Jobs finished by the workers are reported by id through done; their
+       continuations stay on the event loop in wait and a single poller
+       runs every finished one once per tick. */
+    struct queue_t {
+        std::mutex mtx; std::vector<ulong> done;
+        std::map<ulong,std::function<void()>> wait;
+        ulong next=0; bool poll=0;
+    };
+
+    /* shared, so that tasks still running at exit keep it alive whatever
+       the order in which statics are destroyed */
+    inline std::shared_ptr<queue_t> queue() noexcept {
+        static auto queue = std::make_shared<queue_t>(); return queue;
+    }
+
+    /* runs work() on the pool and then done() on the event loop; work must
+       only touch std types and raw buffers that outlive it */
+    template< class T, class U >
+    void async( T work, U done ) noexcept {
+        auto ptr = queue(); auto& que = *ptr; ulong id = ++que.next; que.wait[ id ] = done;
+
+        get().push([=](){ work(); auto& que = *ptr;
+            std::unique_lock<std::mutex> lock( que.mtx ); que.done.push_back( id );
+        }); if( que.poll ){ return; } que.poll = 1;
+
+        process::add([=](){ auto& que = *ptr; std::vector<ulong> list;
+            do { std::unique_lock<std::mutex> lock( que.mtx ); list.swap( que.done ); } while(0);
+            for( auto x : list ){ auto fn = std::move( que.wait[ x ] ); que.wait.erase( x ); fn(); }
+            if( !que.wait.empty() ){ return 1; } que.poll = 0; return -1;
+        });
+    }
+
+}}}
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#endif
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2023 The Nodepp Project Authors. All Rights Reserved.
+ *
+ * Licensed under the MIT (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://github.com/NodeppOficial/nodepp/blob/main/LICENSE
+ */
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#ifndef NODEPP_WPGP_SEEK
+#define NODEPP_WPGP_SEEK
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#include <nodepp/nodepp.h>
+#include "aead.h"
+
+#include <cstdio>
+#include <vector>
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+/* Block index of seekable messages, stored as their last body item:
+     "WPGI" chunk count { offset }... size length
+   chunk, count and length are big endian uint32, offset and size uint64.
+   offset x is the file position where chunk x's body item starts, size
+   is the plaintext length and length repeats the index size, so binary
+   files can find the index from their end. */
+
+namespace nodepp { namespace wpgp { namespace seek {
+
+    enum { HEAD = 12, TAIL = 12 };
+
+    struct index_t {
+        ulong chunk = 0; ullong size = 0;
+        std::vector<ullong> off;
+    };
+
+    inline ulong get_uint32( const uchar* raw ) noexcept {
+        return ( (ulong) raw[0] << 24 ) | ( (ulong) raw[1] << 16 ) | ( (ulong) raw[2] << 8 ) | raw[3];
+    }
+
+    inline void set_uint32( uchar* raw, ulong value ) noexcept {
+        raw[0] = value >> 24; raw[1] = value >> 16; raw[2] = value >> 8; raw[3] = value;
+    }
+
+    /*─······································································─*/
+
+    inline string_t write( const index_t& idx ) noexcept {
+        ulong len = HEAD + idx.off.size() * 8 + TAIL;
+        auto  out = string_t( len, '\0' ); auto raw = (uchar*) out.get();
+
+        memcpy( raw, "WPGI", 4 ); set_uint32( raw + 4, idx.chunk ); set_uint32( raw + 8, idx.off.size() );
+        for( ulong x=0; x<idx.off.size(); x++ ){ aead::set_uint64( raw + HEAD + x * 8, idx.off[x] ); }
+        aead::set_uint64( raw + len - TAIL, idx.size ); set_uint32( raw + len - 4, len ); return out;
+    }
+
+    /* parses an index and checks that it describes limit bytes of file
+       holding size bytes of plaintext in full chunks but the last */
+    inline bool read( const char* data, ulong len, ullong limit, index_t& idx ) noexcept {
+        auto raw = (const uchar*) data; if( len < HEAD + TAIL || memcmp( raw, "WPGI", 4 ) != 0 ){ return false; }
+        ulong count = get_uint32( raw + 8 ); idx.chunk = get_uint32( raw + 4 );
+        if( count == 0 || idx.chunk == 0 || len != HEAD + count * 8 + TAIL || get_uint32( raw + len - 4 ) != len )
+          { return false; }
+
+        idx.size = aead::get_uint64( raw + len - TAIL );
+        if( ( idx.size + idx.chunk - 1 ) / idx.chunk != ( idx.size == 0 ? 0 : count ) && !( idx.size == 0 && count == 1 ) )
+          { return false; }
+
+        idx.off.resize( count ); for( ulong x=0; x<count; x++ ){
+            idx.off[x] = aead::get_uint64( raw + HEAD + x * 8 );
+            if( idx.off[x] >= limit || ( x > 0 && idx.off[x] <= idx.off[x-1] ) ){ return false; }
+        }   return true;
+    }
+
+    /*─······································································─*/
+
+    /* positioned reads on a file, without the event loop */
+    class reader_t {
+        FILE* fd = nullptr; ullong len = 0;
+    public:
+        reader_t( const string_t& path ) noexcept {
+            fd = fopen( path.get(), "rb" ); if( fd == nullptr ){ return; }
+        #ifdef _WIN32
+            _fseeki64( fd, 0, SEEK_END ); len = _ftelli64( fd );
+        #else
+            fseeko( fd, 0, SEEK_END ); len = ftello( fd );
+        #endif
+        }
+       ~reader_t() noexcept { if( fd != nullptr ){ fclose( fd ); } }
+        reader_t( const reader_t& ) = delete; reader_t& operator=( const reader_t& ) = delete;
+
+        bool   is_open() const noexcept { return fd != nullptr; }
+        ullong size()    const noexcept { return len; }
+
+        string_t read( ullong pos, ulong size ) const noexcept {
+            if( fd == nullptr || pos > len || size > len - pos ){ return nullptr; }
+        #ifdef _WIN32
+            if( _fseeki64( fd, pos, SEEK_SET ) != 0 ){ return nullptr; }
+        #else
+            if( fseeko( fd, pos, SEEK_SET ) != 0 ){ return nullptr; }
+        #endif
+            auto out = string_t( size, '\0' );
+            if( size > 0 && fread( out.get(), 1, size, fd ) != size ){ return nullptr; } return out;
+        }
+    };
+
+}}}
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2023 The Nodepp Project Authors. All Rights Reserved.
+ *
+ * Licensed under the MIT (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://github.com/NodeppOficial/nodepp/blob/main/LICENSE
+ */
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#ifndef NODEPP_WPGP_SIGN
+#define NODEPP_WPGP_SIGN
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#include <nodepp/nodepp.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+#include <openssl/x509.h>
+
+#include <cstring>
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+/* RSASSA-PKCS1-v1_5 over SHA256 digests. Keys are parsed once from PEM
+   into an EVP_PKEY, which OpenSSL allows to share across threads; every
+   call builds its own EVP_PKEY_CTX. */
+
+namespace nodepp { namespace wpgp { namespace sign {
+
+    enum { DIGEST = 32 };
+
+    /* parses an RSA key from PEM, either PKCS#1 or PKCS#8 / SPKI */
+    inline EVP_PKEY* load( const char* pem, ulong size ) noexcept {
+        BIO* bio = BIO_new_mem_buf( pem, (int) size ); if( bio == nullptr ){ return nullptr; }
+        char* name = nullptr; char* head = nullptr; uchar* data = nullptr; long len = 0;
+        EVP_PKEY* key = nullptr;
+
+        if( PEM_read_bio( bio, &name, &head, &data, &len ) == 1 ){
+            const uchar* raw = data;
+            if     ( strcmp( name, "PUBLIC KEY"      ) == 0 ){ key = d2i_PUBKEY( nullptr, &raw, len ); }
+            else if( strcmp( name, "RSA PUBLIC KEY"  ) == 0 ){ key = d2i_PublicKey( EVP_PKEY_RSA, nullptr, &raw, len ); }
+            else if( strcmp( name, "RSA PRIVATE KEY" ) == 0 ){ key = d2i_PrivateKey( EVP_PKEY_RSA, nullptr, &raw, len ); }
+            else if( strcmp( name, "PRIVATE KEY"     ) == 0 ){ key = d2i_AutoPrivateKey( nullptr, &raw, len ); }
+        }
+
+        if( data != nullptr ){ OPENSSL_cleanse( data, len ); OPENSSL_free( data ); }
+        OPENSSL_free( name ); OPENSSL_free( head ); BIO_free( bio ); return key;
+    }
+
+    /*─······································································─*/
+
+    /* incremental SHA256 over raw bytes */
+    class hash_t {
+        EVP_MD_CTX* ctx;
+    public:
+        hash_t() noexcept : ctx( EVP_MD_CTX_new() ) { EVP_DigestInit_ex( ctx, EVP_sha256(), nullptr ); }
+       ~hash_t() noexcept { EVP_MD_CTX_free( ctx ); }
+        hash_t( const hash_t& ) = delete; hash_t& operator=( const hash_t& ) = delete;
+
+        void update( const void* data, ulong size ) noexcept { EVP_DigestUpdate( ctx, data, size ); }
+        void get( uchar* out ) noexcept { uint len = DIGEST; EVP_DigestFinal_ex( ctx, out, &len ); }
+    };
+
+    /*─······································································─*/
+
+    inline bool sign( EVP_PKEY* key, const uchar* digest, uchar* out, ulong& size ) noexcept {
+        EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new( key, nullptr ); size_t len = size; bool done = false;
+        if( ctx != nullptr && EVP_PKEY_sign_init( ctx ) > 0 &&
+            EVP_PKEY_CTX_set_rsa_padding( ctx, RSA_PKCS1_PADDING ) > 0 &&
+            EVP_PKEY_CTX_set_signature_md( ctx, EVP_sha256() ) > 0 &&
+            EVP_PKEY_sign( ctx, out, &len, digest, DIGEST ) > 0 ){ size = len; done = true; }
+        EVP_PKEY_CTX_free( ctx ); return done;
+    }
+
+    inline bool verify( EVP_PKEY* key, const uchar* digest, const uchar* sig, ulong size ) noexcept {
+        EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new( key, nullptr ); bool done = false;
+        if( ctx != nullptr && EVP_PKEY_verify_init( ctx ) > 0 &&
+            EVP_PKEY_CTX_set_rsa_padding( ctx, RSA_PKCS1_PADDING ) > 0 &&
+            EVP_PKEY_CTX_set_signature_md( ctx, EVP_sha256() ) > 0 &&
+            EVP_PKEY_verify( ctx, sig, size, digest, DIGEST ) == 1 ){ done = true; }
+        EVP_PKEY_CTX_free( ctx ); return done;
+    }
+
+}}}
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#endif
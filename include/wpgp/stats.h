@@ -0,0 +1,157 @@
+/*
+ * Copyright 2023 The Nodepp Project Authors. All Rights Reserved.
+ *
+ * Licensed under the MIT (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://github.com/NodeppOficial/nodepp/blob/main/LICENSE
+ */
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#ifndef NODEPP_WPGP_STATS
+#define NODEPP_WPGP_STATS
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#include <nodepp/nodepp.h>
+#include <nodepp/json.h>
+
+#ifdef WPGP_STATS
+#include <chrono>
+#include <atomic>
+#endif
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+/* Instrumentation is compiled in with -DWPGP_STATS. Stages record calls,
+   bytes and nanoseconds; every WPGP_ERROR site records its failures.
+   Counters are atomic since stages also run on the worker pool. Without
+   the define the macros expand to plain _EERROR or to nothing and
+   snapshot() returns an empty object. */
+
+namespace nodepp { namespace wpgp { namespace stats {
+
+    enum STAGE {
+        PARSE,      // envelope framing
+        SHA256,     // envelope hash and verify
+        MASK,       // fused base64 + XOR
+        JSON,       // header parse
+        RSA_WRAP,   // session key public_encrypt
+        RSA_UNWRAP, // session key private_decrypt
+        AES,        // legacy AES-256-ECB body
+        AEAD_SEAL,  // chunked AES-256-GCM seal
+        AEAD_OPEN,  // chunked AES-256-GCM open
+        KEYGEN,     // RSA key generation
+        RSA_SIGN,   // signature creation
+        RSA_VERIFY, // signature verification
+        DEFLATE,    // plaintext compression
+        INFLATE,    // plaintext decompression
+        ECDH_WRAP,  // session key X25519 seal
+        ECDH_UNWRAP,// session key X25519 open
+        STAGES
+    };
+
+    inline const char* stage_name( ulong stage ) noexcept {
+        static const char* name[] = {
+            "parse", "sha256", "mask", "json", "rsa_wrap", "rsa_unwrap",
+            "aes", "aead_seal", "aead_open", "keygen", "rsa_sign", "rsa_verify",
+            "deflate", "inflate", "ecdh_wrap", "ecdh_unwrap"
+        };  return stage < STAGES ? name[stage] : "";
+    }
+
+#ifdef WPGP_STATS
+
+    struct counter_t {
+        std::atomic<ullong> count{0}, bytes{0}, nanos{0};
+    };
+
+    inline counter_t* stage() noexcept { static counter_t list[ STAGES ]; return list; }
+
+    /* one per WPGP_ERROR site, linked into a lock free list on first use */
+    struct site_t {
+        const char* file; ulong line; const char* msg;
+        std::atomic<ullong> count{0}; site_t* next=nullptr;
+
+        static std::atomic<site_t*>& head() noexcept { static std::atomic<site_t*> head{nullptr}; return head; }
+
+        site_t( const char* _file, ulong _line, const char* _msg ) noexcept
+            : file( _file ), line( _line ), msg( _msg ) {
+            next = head().load(); while( !head().compare_exchange_weak( next, this ) ){}
+        }
+    };
+
+    class scope_t {
+        counter_t* ctr; std::chrono::steady_clock::time_point start;
+    public:
+        scope_t( ulong stage, ulong bytes ) noexcept : ctr( stats::stage() + stage ),
+            start( std::chrono::steady_clock::now() ) {
+            ctr->count.fetch_add( 1, std::memory_order_relaxed );
+            ctr->bytes.fetch_add( bytes, std::memory_order_relaxed );
+        }
+       ~scope_t() noexcept { ctr->nanos.fetch_add( std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start ).count(), std::memory_order_relaxed );
+        }
+    };
+
+    /* { stages: { name: { count, bytes, nanos } }, failures: [ { site, message, count } ] } */
+    inline object_t snapshot() noexcept {
+        object_t stages; array_t<object_t> fails;
+
+        for( ulong x=0; x<STAGES; x++ ){ auto& ctr = stage()[x];
+            stages[ stage_name( x ) ] = object_t({
+                { "count", ctr.count.load() }, { "bytes", ctr.bytes.load() }, { "nanos", ctr.nanos.load() }
+            });
+        }
+
+        for( auto x = site_t::head().load(); x != nullptr; x = x->next ){
+            fails.push( object_t({
+                { "site"   , string::format( "%s:%lu", x->file, x->line ) },
+                { "message", string_t( x->msg ) }, { "count", x->count.load() }
+            }));
+        }
+
+        return object_t({ { "stages", stages }, { "failures", fails } });
+    }
+
+    inline void reset() noexcept {
+        for( ulong x=0; x<STAGES; x++ ){ auto& ctr = stage()[x];
+             ctr.count = 0; ctr.bytes = 0; ctr.nanos = 0;
+        }
+        for( auto x = site_t::head().load(); x != nullptr; x = x->next ){ x->count = 0; }
+    }
+
+#else
+
+    inline object_t snapshot() noexcept { return object_t(); }
+    inline void reset() noexcept {}
+
+#endif
+
+}}}
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#ifdef WPGP_STATS
+
+#define WPGP_CONCAT_( A, B ) A##B
+#define WPGP_CONCAT( A, B ) WPGP_CONCAT_( A, B )
+
+#define WPGP_STAGE( STAGE, BYTES ) \
+    nodepp::wpgp::stats::scope_t WPGP_CONCAT( _wpgp_stage_, __LINE__ )( nodepp::wpgp::stats::STAGE, BYTES )
+
+#define WPGP_ERROR( EV, MSG ) do { \
+    static nodepp::wpgp::stats::site_t _wpgp_site_( __FILE__, __LINE__, MSG ); \
+    _wpgp_site_.count.fetch_add( 1, std::memory_order_relaxed ); _EERROR( EV, MSG ); \
+} while(0)
+
+#else
+
+#define WPGP_STAGE( STAGE, BYTES )
+#define WPGP_ERROR( EV, MSG ) _EERROR( EV, MSG )
+
+#endif
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#endif
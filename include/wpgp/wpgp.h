@@ -22,77 +22,1370 @@
 #include <nodepp/json.h>
 #include <nodepp/fs.h>
 
+#include <mutex>
+
+#include "aead.h"
+#include "pool.h"
+#include "keygen.h"
+#include "kernel.h"
+#include "stats.h"
+#include "sign.h"
+#include "zip.h"
+#include "ecc.h"
+#include "pem.h"
+#include "seek.h"
+#include "file.h"
+#include "lru.h"
+
 /*────────────────────────────────────────────────────────────────────────────*/
-    
+
 namespace nodepp { class wpgp_t {
 protected:
 
     struct CTX {
-        char format[5] = {"WPGP"};
+        char format[4] = {'W','P','G','P'};
+        char   flag    = 0;
         char   mask[5] ;
     };
 
+    enum FLAG {
+        FLAG_CHUNK = 0b00000001,
+        FLAG_SALT  = 0b00000010,
+        FLAG_MULTI = 0b00000100,
+        FLAG_SIGN  = 0b00001000,
+        FLAG_ZIP   = 0b00010000,
+        FLAG_SEEK  = 0b00100000
+    };
+
+    enum { HASH = 64 }; // SHA256 hex digest length
+    enum { KEYHEAD = 36, KEYSUM = 32 }; // binary key header and checksum sizes
+    enum { FORM_DER = 0, FORM_PEM = 1, FORM_RAW = 2 }; // binary key bodies
+    enum { SALT = 16 }; // per message salt of batched chunked messages
+
+    struct SEAL {
+        uchar key [ wpgp::aead::KEY  ];
+        uchar salt[ wpgp::aead::SALT ];
+    };
+
+    /* chunk of an incoming message: ciphertext without its tag, and where
+       its plaintext goes */
+    struct ITEM { const char* ptr; ulong len, off; };
+
+    /* Reusable state of the _into calls: the session of outgoing messages
+       with its encoded head, the last session opened for incoming ones
+       keyed by its raw header bytes, and scratch space. */
+    struct INTO {
+        SEAL     seal[2]; bool open[2] = { 0, 0 }; // outgoing / incoming
+        CTX      ctx ; string_t head; // outgoing context and head
+        string_t wrap; // incoming raw header
+        std::vector<char> buff; std::vector<ITEM> item;
+       ~INTO() noexcept { OPENSSL_cleanse( seal, sizeof( seal ) ); }
+    };
+
+    /* unwrapped session header, cached under the digest of its wrapped
+       form; the whole digest is kept so that key collisions never match.
+       Pool workers reach the cache too, so it holds plain bytes rather
+       than ref-counted string_t */
+    struct UNWRAP {
+        uchar sum[ HASH / 2 ]; std::string data;
+        static void drop( UNWRAP& item ) noexcept { OPENSSL_cleanse( item.sum, sizeof( item.sum ) );
+            if( !item.data.empty() ){ OPENSSL_cleanse( &item.data[0], item.data.size() ); }
+        }
+    };
+
     struct NODE {
         bool  state=0;
 
-        ulong    size; // RSA size
+        ulong    size; // RSA size, or 25519 for X25519
         bool     prvt; // Private Key Bool
         string_t name; // User Name
         string_t mail; // User Mail
         string_t cmmt; // User Comment
         uint  stmp[2]; // Expiration Stamp
         rsa_t fd;      // RSA File Descriptor
+        bool  ec   =0; // X25519 Key
+        uchar ecc[2][ wpgp::ecc::KEY ]; // X25519 Private / Public
+        string_t pkey; // Cached Public Key PEM
+        string_t fprt; // Public Key Fingerprint
+        ulong chunk=0; // AEAD Chunk Size
+        bool  bin  =0; // Binary Wire Format
+        uint  zip  =0; // Deflate Level, 0 Disables It
+        ulong inflate=67108864; // Inflated Size Limit
+        bool  seek =0; // Seekable Chunked Messages
+
+        ulong mark[2] = { 1048576, 262144 }; // High / Low Watermarks
+        ulong pend =0; // Bytes Queued Downstream
+        bool  hold =0; // Paused By The Watermarks
+        bool  stop =0; // Paused By The Consumer
+        bool  done =0; // Pipe Finished, onClose Pending
+
+        EVP_PKEY* evp = nullptr; // Parsed Signing Key
+        INTO  into;    // State Of The _into Calls
+        wpgp::lru_t<UNWRAP> keys = wpgp::lru_t<UNWRAP>( 0, &UNWRAP::drop ); // Unwrapped Sessions
+        std::mutex lock; // Guards keys
+       ~NODE() noexcept { if( evp != nullptr ){ EVP_PKEY_free( evp ); } OPENSSL_cleanse( ecc, sizeof( ecc ) ); }
 
     };  ptr_t<NODE> obj;
 
     /*─······································································─*/
 
-    bool verify_from_memory( const string_t& pkey ) const noexcept {
-        try { if( pkey.empty() ){ return false; }
+    /* pipes decide on compression from the first piece they read, so the
+       envelope head that carries FLAG_ZIP is only emitted then */
+    struct ZIP { wpgp::zip::stream_t fd; bool head=0; };
 
-            CTX ctx; memcpy( &ctx, pkey.get(), sizeof( CTX ) );
-            
-            auto pos = regex::search_all( pkey, "[^.]+" ); pos.shift();
-            if ( pos.empty() ){ return false; }
+    /*─······································································─*/
 
-            try { 
+    struct VIEW {
+        CTX   ctx    ; // envelope context
+        ulong head[2]; // header byte range
+        ulong body[2]; // body   byte range
+        ulong hash[2]; // hash   byte range
+    };
 
-            auto header = json::parse( encoder::XOR::get( encoder::base64::set( 
-                 pkey.slice( pos[0][0], pos[0][1] )
-            ), ctx.mask ));
+    /*─······································································─*/
+
+    static string_t set_uint32( ulong value ) noexcept {
+        char raw[4] = { (char)( value >> 24 ), (char)( value >> 16 ), (char)( value >> 8 ), (char) value };
+        return string_t( raw, 4 );
+    }
+
+    static void put_uint32( char* out, ulong value ) noexcept {
+        out[0] = value >> 24; out[1] = value >> 16; out[2] = value >> 8; out[3] = value;
+    }
+
+    static void put_hex( const uchar* in, ulong size, char* out ) noexcept {
+        static const char hex[] = "0123456789abcdef";
+        for( ulong x=0; x<size; x++ ){ out[x*2] = hex[ in[x] >> 4 ]; out[x*2+1] = hex[ in[x] & 15 ]; }
+    }
+
+    /* every envelope hash is compared through here: put_hex writes lower
+       case and crypto::hash need not, so the case of letters is ignored */
+    static bool same_hex( const char* a, const char* b, ulong size ) noexcept {
+        for( ulong x=0; x<size; x++ ){ if( ( a[x] | 0x20 ) != ( b[x] | 0x20 ) ){ return false; } }
+        return true;
+    }
+
+    static ulong get_uint32( const char* raw ) noexcept { auto x = (const uchar*) raw;
+        return ( (ulong) x[0] << 24 ) | ( (ulong) x[1] << 16 ) | ( (ulong) x[2] << 8 ) | x[3];
+    }
+
+    static bool is_binary( const CTX& ctx ) noexcept {
+        return memcmp( ctx.format, "WPGB", 4 ) == 0;
+    }
+
+    static bool is_valid( const CTX& ctx ) noexcept {
+        return is_binary( ctx ) || memcmp( ctx.format, "WPGP", 4 ) == 0;
+    }
+
+    CTX new_ctx( char flag ) const noexcept { CTX ctx; ctx.flag = flag;
+        if( obj->bin ){ memcpy( ctx.format, "WPGB", 4 ); }
+        memcpy( &ctx.mask, encoder::key::generate( 4 ).get(), 5 ); return ctx;
+    }
+
+    /*─······································································─*/
+
+    static ulong mask_size( const CTX& ctx ) noexcept {
+        return strnlen( ctx.mask, sizeof( ctx.mask ) );
+    }
+
+    /* base64( XOR( data, mask ) ) and its inverse in a single pass */
+    static string_t mask_encode( const CTX& ctx, const string_t& data ) noexcept {
+        WPGP_STAGE( MASK, data.size() );
+        wpgp::kernel_t krn( ctx.mask, mask_size( ctx ) );
+        auto out = string_t( krn.encode_size( data.size(), true ), '\0' );
+        krn.encode( data.get(), data.size(), out.get(), true ); return out;
+    }
+
+    static string_t mask_decode( const CTX& ctx, const char* data, ulong size ) noexcept {
+        WPGP_STAGE( MASK, size );
+        wpgp::kernel_t krn( ctx.mask, mask_size( ctx ) );
+        auto out = string_t( krn.decode_size( size ), '\0' );
+        long len = krn.decode( data, size, out.get(), true );
+        if( len < 0 ){ return nullptr; } return (ulong) len == out.size() ? out : out.slice( 0, len );
+    }
+
+    /*─······································································─*/
+
+    /* Text envelopes are   CTX . header . body[:body...] . hash
+       Binary envelopes are CTX len header { len body }... 0 len hash
+       where len is a big endian uint32 and the hash covers every byte
+       that precedes it. */
+
+    bool parse_from_memory( const string_t& data, VIEW& view ) const noexcept {
+        WPGP_STAGE( PARSE, data.size() ); ulong size = data.size(); const char* raw = data.get();
+        if( size < sizeof( CTX ) + 1 ){ return false; } memcpy( &view.ctx, raw, sizeof( CTX ) );
+
+        if( is_binary( view.ctx ) ){ ulong pos = sizeof( CTX ), len = 0;
+            if( size - pos < 4 ){ return false; } len = get_uint32( raw + pos ); pos += 4;
+            if( size - pos < len ){ return false; }
+            view.head[0] = pos; pos += len; view.head[1] = pos; view.body[0] = pos;
+
+            do { if( size - pos < 4 ){ return false; } len = get_uint32( raw + pos ); pos += 4;
+                 if( size - pos < len ){ return false; } pos += len;
+            } while( len != 0 ); view.body[1] = pos;
+
+            if( size - pos < 4 ){ return false; } len = get_uint32( raw + pos ); pos += 4;
+            if( size - pos != len || len == 0 ){ return false; }
+            view.hash[0] = pos; view.hash[1] = size; return true;
+        }
+
+        if( !is_valid( view.ctx ) || raw[ sizeof( CTX ) ] != '.' ){ return false; }
+
+        ulong* field[3] = { view.head, view.body, view.hash };
+        ulong  pos = sizeof( CTX ) + 1;
+
+        for( ulong x=0; x<3; x++ ){
+            const char* end = (const char*) memchr( raw + pos, '.', size - pos );
+            field[x][0] = pos; field[x][1] = end==nullptr ? size : end - raw;
+            if( field[x][1] == field[x][0] ){ return false; }
+            if( end == nullptr && x != 2 ){ return false; } pos = field[x][1] + 1;
+        }
+
+        return true;
+    }
+
+    string_t decode_from_memory( const string_t& data, const VIEW& view, const ulong* range ) const noexcept {
+        if( is_binary( view.ctx ) ){ return data.slice( range[0], range[1] ); }
+        return mask_decode( view.ctx, data.get() + range[0], range[1] - range[0] );
+    }
+
+    array_t<string_t> body_from_memory( const string_t& data, const VIEW& view ) const noexcept {
+        array_t<string_t> out; ulong pos = view.body[0];
+
+        if( is_binary( view.ctx ) ){ while( true ){
+            ulong len = get_uint32( data.get() + pos ); pos += 4; if( len == 0 ){ break; }
+            out.push( data.slice( pos, pos + len ) ); pos += len;
+        }   return out; }
+
+        while( pos <= view.body[1] ){ ulong range[2] = { pos, view.body[1] };
+            const char* end = (const char*) memchr( data.get() + pos, ':', view.body[1] - pos );
+            if( end != nullptr ){ range[1] = end - data.get(); } pos = range[1] + 1;
+            out.push( decode_from_memory( data, view, range ) );
+        }   return out;
+    }
 
-            auto exp  = header["expiration"];
+    bool verify_from_memory( const string_t& data, const VIEW& view ) const noexcept {
+        return check_hash( data, view );
+    }
 
-            auto body = encoder::XOR::get( encoder::base64::set( 
-                 pkey.slice( pos[1][0], pos[1][1] ) 
-            ), ctx.mask );
+    bool verify_expiration( uint stamp, uint days ) const noexcept {
+        return stamp == 0 || stamp + days >= process::seconds() / 86400;
+    }
 
+    bool verify_expiration( const object_t& header ) const noexcept {
+        try { auto exp = header["expiration"];
             if( exp.has_value() && exp[0].as<uint>() != 0 )
             if( exp[0].as<uint>()+exp[1].as<uint>() < process::seconds()/86400 ){ return false; }
+        } catch( ... ) {}     return true;
+    }
 
-            } catch( ... ) {}
+    bool verify_from_memory( const string_t& pkey ) const noexcept {
+        if( is_binary_key( pkey ) ){ return verify_binary_key( pkey ) && verify_expiration(
+            get_uint32( pkey.get() + 12 ), get_uint32( pkey.get() + 16 )
+        ); }
+        try { VIEW view; if( pkey.empty() ){ return false; }
+            if( !parse_from_memory ( pkey, view ) ){ return false; }
+            if( !verify_from_memory( pkey, view ) ){ return false; }
+            try { return verify_expiration( parse_json(
+                  decode_from_memory( pkey, view, view.head )
+            )); } catch( ... ) {} return true;
+        } catch( ... ){ return false; }
+    }
 
-            auto hash = pkey.slice( pos[2][0], pos[2][1] ); 
-            auto sha  = crypto::hash::SHA256(); sha.update( 
-                 pkey.slice( 0, pos[1][1] + 1 )
-            );
+    /*─······································································─*/
 
-            if( memcmp( ctx.format, "WPGP", 5 ) < 0 ){ return false; }
-            if( hash != sha.get() )                  { return false; }
+    string_t head_to_memory( const CTX& ctx, const string_t& header ) const noexcept {
+        auto data = string_t( (char*)& ctx, sizeof( CTX ) );
+        if( is_binary( ctx ) ){ return data + set_uint32( header.size() ) + header; }
+        return data + "." + mask_encode( ctx, header ) + ".";
+    }
 
-                        return true;
-        } catch( ... ){ return false; }
+    string_t item_to_memory( const CTX& ctx, const string_t& item, bool last ) const noexcept {
+        if( is_binary( ctx ) ){ return set_uint32( item.size() ) + item; }
+        return mask_encode( ctx, item ) + ( last ? "." : ":" );
+    }
+
+    string_t tail_to_memory( const CTX& ctx ) const noexcept {
+        if( is_binary( ctx ) ){ return set_uint32( 0 ) + set_uint32( HASH ); }
+        return nullptr;
+    }
+
+    string_t envelope_to_memory( const CTX& ctx, const string_t& header, const array_t<string_t>& body ) const noexcept {
+        auto sha  = crypto::hash::SHA256();
+        auto data = head_to_memory( ctx, header );
+        for( ulong x=0; x<body.size(); x++ )
+           { data += item_to_memory( ctx, body[x], x+1==body.size() ); }
+        data += tail_to_memory( ctx ); do { WPGP_STAGE( SHA256, data.size() );
+             sha.update( data ); data += sha.get();
+        } while(0); return data;
+    }
+
+    /*─······································································─*/
+
+    /* Binary keys skip the envelope, the JSON header and base64:
+         "WPGK" version kind form label_len size stamp[2] name_len mail_len
+         cmmt_len body_len | label name mail cmmt body | SHA256
+       The four bytes after the magic are single bytes and the rest of the
+       header is big endian uint32. The body is DER, a PEM block kept as
+       is when it has headers (password protected), or a raw X25519 key. */
+
+    static bool is_binary_key( const string_t& pkey ) noexcept {
+        return pkey.size() >= 4 && memcmp( pkey.get(), "WPGK", 4 ) == 0;
+    }
+
+    static bool verify_binary_key( const string_t& pkey ) noexcept {
+        const char* raw = pkey.get(); ulong size = pkey.size(), len = 0;
+        if( size < KEYHEAD + KEYSUM || !is_binary_key( pkey ) || raw[4] != 1 ){ return false; }
+        len = (uchar) raw[7]; for( ulong x=20; x<KEYHEAD; x+=4 ){ len += get_uint32( raw + x ); }
+        if( len != size - KEYHEAD - KEYSUM ){ return false; }
+
+        uchar sum[ KEYSUM ]; WPGP_STAGE( SHA256, size - KEYSUM );
+        wpgp::aead::digest( raw, size - KEYSUM, sum );
+        return memcmp( sum, raw + size - KEYSUM, KEYSUM ) == 0;
+    }
+
+    string_t write_key_to_binary( const string_t& type, const string_t& body ) const noexcept {
+        string_t label, key = body; char form = FORM_RAW;
+        if( !obj->ec ){ form = wpgp::pem::to_der( body, label, key ) ? FORM_DER : FORM_PEM; }
+        if( form == FORM_PEM ){ label = nullptr; key = body; }
+
+        char head[4] = { 1, type == "PRIVATE", form, (char) label.size() };
+        auto data = string_t( "WPGK", 4 ) + string_t( head, 4 )
+                  + set_uint32( obj->size ) + set_uint32( obj->stmp[0] ) + set_uint32( obj->stmp[1] )
+                  + set_uint32( obj->name.size() ) + set_uint32( obj->mail.size() )
+                  + set_uint32( obj->cmmt.size() ) + set_uint32( key.size() )
+                  + label + obj->name + obj->mail + obj->cmmt + key;
+
+        uchar sum[ KEYSUM ]; wpgp::aead::digest( data.get(), data.size(), sum );
+        return data + string_t( (char*) sum, KEYSUM );
+    }
+
+    bool read_key_from_binary( const string_t& pkey, const string_t& type, const string_t& pass ) const {
+        if( !verify_binary_key( pkey ) ){ return false; } const char* raw = pkey.get();
+        if( raw[5] != ( type == "PRIVATE" ) || raw[6] > FORM_RAW ){ return false; }
+        if( !verify_expiration( get_uint32( raw + 12 ), get_uint32( raw + 16 ) ) ){ return false; }
+
+        string_t field[5]; ulong pos = KEYHEAD;
+        ulong len  [5] = { (uchar) raw[7], get_uint32( raw + 20 ), get_uint32( raw + 24 ),
+                                           get_uint32( raw + 28 ), get_uint32( raw + 32 ) };
+        for( ulong x=0; x<5; x++ ){ field[x] = pkey.slice( pos, pos + len[x] ); pos += len[x]; }
+
+        obj->prvt    = raw[5] == 1;
+        obj->size    = get_uint32( raw + 8  );
+        obj->stmp[0] = get_uint32( raw + 12 );
+        obj->stmp[1] = get_uint32( raw + 16 );
+        obj->name    = field[1]; obj->mail = field[2]; obj->cmmt = field[3];
+        obj->ec      = obj->size == wpgp::ecc::SIZE;
+
+        if( obj->ec != ( raw[6] == FORM_RAW ) ){ return false; }
+        if( obj->ec ){ if( !read_ecc_key( field[4], pass ) ){ return false; } } else {
+            auto body = raw[6] == FORM_DER ? wpgp::pem::from_der( field[0], field[4] ) : field[4];
+            if( obj->prvt ){ obj->fd.read_private_key_from_memory( body, pass.get() ); }
+            else           { obj->fd.read_public_key_from_memory ( body ); }
+            if( obj->prvt && raw[6] == FORM_DER ){ OPENSSL_cleanse( body.get(), body.size() ); }
+        }
+
+        cache_key(); return true;
+    }
+
+    /*─······································································─*/
+
+    void read_key_from_memory( const string_t& pkey, const string_t& type, const string_t& pass ) const {
+        if( is_binary_key( pkey ) ){ if( !read_key_from_binary( pkey, type, pass ) )
+          { WPGP_ERROR( onError, "Invalid WPGP Key" ); } return; }
+
+        VIEW view; if( !parse_from_memory( pkey, view ) || !verify_from_memory( pkey, view ) )
+          { WPGP_ERROR( onError, "Invalid WPGP Key" ); return; }
+
+        auto header = parse_json( decode_from_memory( pkey, view, view.head ) );
+        auto body   = body_from_memory( pkey, view );
+
+        if( body.size() != 1 || !verify_expiration( header ) || header["type"].as<string_t>() != type )
+          { WPGP_ERROR( onError, "Invalid WPGP Key" ); return; }
+
+        obj->prvt    = type == "PRIVATE";
+        obj->size    = header["size"].as<uint>();
+        obj->name    = header["name"].as<string_t>();
+        obj->mail    = header["mail"].as<string_t>();
+        obj->cmmt    = header["comment"].as<string_t>();
+        obj->stmp[0] = header["expiration"][0].as<int>();
+        obj->stmp[1] = header["expiration"][1].as<int>();
+        obj->ec      = obj->size == wpgp::ecc::SIZE;
+
+        if( obj->ec ){ if( !read_ecc_key( body[0], pass ) )
+                         { WPGP_ERROR( onError, "Invalid WPGP Key" ); return; } }
+        else if( obj->prvt ){ obj->fd.read_private_key_from_memory( body[0], pass.get() ); }
+        else                { obj->fd.read_public_key_from_memory ( body[0] ); }
+
+        cache_key();
+    }
+
+    void set_user( const string_t& _name, const string_t& _mail, const string_t& _cmmt, uint max_age, uint size ) const noexcept {
+        if( max_age == 0 ) { obj->stmp[0] = 0; obj->stmp[1] = 0; } else {
+            obj->stmp[0] = process::seconds() / 86400;
+            obj->stmp[1] = min( max_age, 365u );
+        }   obj->size = size; obj->name = _name; obj->mail = _mail; obj->cmmt = _cmmt; obj->prvt = true;
+        cache_key();
+    }
+
+    /* X25519 key bodies are the raw 32 byte key; private keys written
+       with a password are stored locked as wpgp::ecc::LOCK bytes */
+    bool read_ecc_key( const string_t& body, const string_t& pass ) const noexcept {
+        auto raw = (const uchar*) body.get(); OPENSSL_cleanse( obj->ecc, sizeof( obj->ecc ) );
+        if( !obj->prvt ){
+            if( body.size() != wpgp::ecc::KEY ){ return false; }
+            memcpy( obj->ecc[1], raw, wpgp::ecc::KEY ); return true;
+        }
+
+        if( body.size() == wpgp::ecc::KEY ){ memcpy( obj->ecc[0], raw, wpgp::ecc::KEY ); }
+        else if( body.size() != wpgp::ecc::LOCK || pass.empty() ||
+                 !wpgp::ecc::unlock( pass.get(), pass.size(), raw, obj->ecc[0] ) ){ return false; }
+        return wpgp::ecc::public_key( obj->ecc[0], obj->ecc[1] );
+    }
+
+    string_t write_ecc_key( const string_t& pass ) const noexcept {
+        if( pass.empty() ){ return string_t( (char*) obj->ecc[0], wpgp::ecc::KEY ); }
+        auto out = string_t( wpgp::ecc::LOCK, '\0' );
+        if( !wpgp::ecc::lock( pass.get(), pass.size(), obj->ecc[0], (uchar*) out.get() ) ){ return nullptr; }
+        return out;
+    }
+
+    void set_user_key( std::string& pem ) const noexcept {
+        obj->fd.read_private_key_from_memory( string_t( pem.data(), pem.size() ), nullptr );
+        wpgp::keygen::clear( pem );
+    }
+
+    void cache_key() const noexcept {
+        if( obj->evp != nullptr ){ EVP_PKEY_free( obj->evp ); obj->evp = nullptr; } reset_into(); clear_keys();
+        auto sha  = crypto::hash::SHA256();
+        obj->pkey = obj->ec ? string_t( (char*) obj->ecc[1], wpgp::ecc::KEY )
+                            : obj->fd.write_public_key_to_memory();
+        sha.update( obj->pkey ); obj->fprt = sha.get();
+    }
+
+    string_t write_key_to_memory( const string_t& type, const string_t& body ) const noexcept {
+        if( obj->bin ){ return write_key_to_binary( type, body ); }
+        auto header = json::stringify( object_t({
+            { "name", obj->name }, { "mail", obj->mail }, { "comment", obj->cmmt },
+            { "expiration", array_t<uint>({ obj->stmp[0], obj->stmp[1] }) },
+            { "size", obj->size }, { "type", type }
+        }));
+        return envelope_to_memory( new_ctx( 0 ), header, array_t<string_t>({ body }) );
+    }
+
+    /*─······································································─*/
+
+    /* RSA or ECDH, JSON and AES steps shared by every message path, each
+       timed as its own stage */
+    string_t wrap_key( const string_t& data ) const {
+        if( obj->ec ){ WPGP_STAGE( ECDH_WRAP, data.size() );
+            auto out = string_t( data.size() + wpgp::ecc::SEAL, '\0' );
+            if( !wpgp::ecc::seal( obj->ecc[1], (uchar*) data.get(), data.size(), (uchar*) out.get() ) )
+              { return nullptr; } return out;
+        }   WPGP_STAGE( RSA_WRAP, data.size() ); return obj->fd.public_encrypt( data );
+    }
+
+    /* served from the session cache when the same wrapped header was seen
+       before; the cache keeps its own copy, so callers may wipe theirs */
+    string_t unwrap_key( const string_t& data ) const {
+        string_t out; if( find_key( data, out ) ){ return out; }
+        out = unwrap_raw( data ); keep_key( data, out ); return out;
+    }
+
+    /* the cache is only touched under obj->lock and from the event loop;
+       the RSA / ECDH step itself never holds it */
+    bool find_key( const string_t& data, string_t& out ) const noexcept {
+        if( get_key_cache() == 0 ){ return false; } uchar sum[ HASH / 2 ];
+        wpgp::aead::digest( data.get(), data.size(), sum ); ullong id = wpgp::aead::get_uint64( sum );
+        std::lock_guard<std::mutex> guard( obj->lock ); auto item = obj->keys.get( id );
+        if( item == nullptr || CRYPTO_memcmp( item->sum, sum, sizeof( sum ) ) != 0 ){ return false; }
+        out = string_t( item->data.data(), item->data.size() ); return true;
+    }
+
+    void keep_key( const string_t& data, const string_t& key ) const noexcept {
+        if( key.empty() || get_key_cache() == 0 ){ return; } UNWRAP next;
+        wpgp::aead::digest( data.get(), data.size(), next.sum ); next.data.assign( key.get(), key.size() );
+        { std::lock_guard<std::mutex> guard( obj->lock ); obj->keys.set( wpgp::aead::get_uint64( next.sum ), next ); }
+        UNWRAP::drop( next );
+    }
+
+    void clear_keys() const noexcept {
+        std::lock_guard<std::mutex> guard( obj->lock ); obj->keys.clear();
+    }
+
+    string_t unwrap_raw( const string_t& data ) const {
+        if( obj->ec ){ WPGP_STAGE( ECDH_UNWRAP, data.size() );
+            if( !obj->prvt || data.size() < wpgp::ecc::SEAL ){ throw except_t( "Invalid WPGP message" ); }
+            auto out = string_t( data.size() - wpgp::ecc::SEAL, '\0' );
+            if( !wpgp::ecc::open( obj->ecc[0], obj->ecc[1], (uchar*) data.get(), data.size(), (uchar*) out.get() ) )
+              { throw except_t( "Invalid WPGP message" ); } return out;
+        }   WPGP_STAGE( RSA_UNWRAP, data.size() ); return obj->fd.private_decrypt( data );
+    }
+
+    static object_t parse_json( const string_t& data ) {
+        WPGP_STAGE( JSON, data.size() ); return json::parse( data );
+    }
+
+    static string_t ecb_encrypt( const string_t& sec, const string_t& msg ) noexcept {
+        WPGP_STAGE( AES, msg.size() ); auto enc = crypto::encrypt::AES_256_ECB( sec );
+        enc.update( msg ); return enc.get();
+    }
+
+    /*─······································································─*/
+
+    /* deflates msg when compression is on and its first block shrinks;
+       returns FLAG_ZIP if msg was replaced by its compressed form */
+    char zip_message( string_t& msg ) const noexcept {
+        if( obj->zip == 0 || obj->seek || !wpgp::zip::worth( msg.get(), msg.size() ) ){ return 0; }
+        WPGP_STAGE( DEFLATE, msg.size() ); wpgp::zip::stream_t zip;
+        if( !zip.start( false, obj->zip ) ){ return 0; }
+        auto out = zip.update( msg.get(), msg.size(), true );
+        if( !zip.is_done() || out.size() >= msg.size() ){ return 0; }
+        msg = out; return FLAG_ZIP;
+    }
+
+    bool unzip_message( const CTX& ctx, string_t& msg ) const noexcept {
+        if( !( ctx.flag & FLAG_ZIP ) ){ return true; } WPGP_STAGE( INFLATE, msg.size() );
+        wpgp::zip::stream_t zip; if( !zip.start( true ) ){ return false; } zip.limit( obj->inflate );
+        auto out = zip.update( msg.get(), msg.size(), true );
+        OPENSSL_cleanse( msg.get(), msg.size() ); msg = out; return zip.is_done();
+    }
+
+    /* decides on compression from the first piece of a pipe and marks
+       ctx, whose flag byte the session then authenticates */
+    void zip_head( ZIP& zip, CTX& ctx, const string_t& data ) const noexcept {
+        zip.head = 1; if( obj->zip > 0 && !obj->seek && wpgp::zip::worth( data.get(), data.size() ) && zip.fd.start( false, obj->zip ) )
+          { ctx.flag |= FLAG_ZIP; }
+    }
+
+    static string_t zip_data( ZIP& zip, const string_t& data, bool last ) noexcept {
+        if( !zip.fd.is_active() ){ return data; } WPGP_STAGE( DEFLATE, data.size() );
+        return zip.fd.update( data.get(), data.size(), last );
+    }
+
+    static string_t unzip_data( ZIP& zip, const string_t& data ) noexcept {
+        if( !zip.fd.is_active() ){ return data; } WPGP_STAGE( INFLATE, data.size() );
+        return zip.fd.update( data.get(), data.size(), false );
+    }
+
+    static bool unzip_done( const ZIP& zip ) noexcept {
+        return !zip.fd.is_active() || zip.fd.is_done();
+    }
+
+    /*─······································································─*/
+
+    string_t new_pass() const noexcept { auto sec = crypto::hash::SHA256();
+        sec.update( string::to_string( rand() ) );
+        sec.update( string::to_string( process::now() ) );
+        sec.update( obj->pkey ); return sec.get();
+    }
+
+    /* ECB bodies carry no tag, so compression is recorded inside the
+       wrapped header too, where the envelope flag cannot be cleared */
+    string_t pass_json( const string_t& sec, bool zip=false ) const noexcept {
+        if( zip ){ return json::stringify( object_t({ { "type", "MESSAGE" }, { "pass", sec }, { "zip", true } }) ); }
+        return json::stringify( object_t({ { "type", "MESSAGE" }, { "pass", sec } }) );
+    }
+
+    string_t pass_header( const string_t& sec, bool zip=false ) const noexcept {
+        return wrap_key( pass_json( sec, zip ) );
+    }
+
+    static bool pass_zip( const object_t& header, const CTX& ctx ) noexcept {
+        return header.has( "zip" ) == !!( ctx.flag & FLAG_ZIP );
+    }
+
+    /*─······································································─*/
+
+    string_t seal_json( SEAL& seal ) const {
+        if( !wpgp::aead::random( seal.key , sizeof( seal.key  ) ) ||
+            !wpgp::aead::random( seal.salt, sizeof( seal.salt ) ) )
+          { throw except_t( "Invalid WPGP message" ); }
+
+        return json::stringify( object_t({ { "type", "MESSAGE" },
+            { "pass", encoder::base64::get( string_t( (char*) seal.key , sizeof( seal.key  ) ) ) },
+            { "salt", encoder::base64::get( string_t( (char*) seal.salt, sizeof( seal.salt ) ) ) }
+        }));
+    }
+
+    string_t seal_header( SEAL& seal ) const {
+        return wrap_key( seal_json( seal ) );
+    }
+
+    /*─······································································─*/
+
+    /* multi recipient headers map each recipient fingerprint to its own
+       RSA wrapped copy of the session header */
+    string_t multi_header( const string_t& data, const array_t<wpgp_t>& list ) const {
+        object_t keys; for( auto& x : list ){
+            if( x.obj->fprt.empty() ){ throw except_t( "Invalid WPGP Key" ); }
+            keys[ x.obj->fprt ] = encoder::base64::get( x.wrap_key( data ) );
+        }   return json::stringify( object_t({ { "type", "MULTI" }, { "keys", keys } }) );
+    }
+
+    string_t pick_header( const CTX& ctx, const string_t& header, const string_t& fprt ) const {
+        if( !( ctx.flag & FLAG_MULTI ) ){ return header; }
+        auto data = parse_json( header ); auto keys = data["keys"];
+        if( data["type"].as<string_t>() != "MULTI" || !keys.has( fprt ) )
+          { throw except_t( "Invalid WPGP message" ); }
+        return encoder::base64::set( keys[ fprt ].as<string_t>() );
+    }
+
+    bool open_header( const string_t& data, SEAL& seal ) const noexcept {
+        try { return read_seal( unwrap_key( data ), seal ); } catch( ... ) { return false; }
+    }
+
+    /* reads the session key and salt out of an unwrapped header */
+    static bool read_seal( const string_t& data, SEAL& seal ) noexcept {
+        try { auto header = parse_json( data );
+
+            auto key  = encoder::base64::set( header["pass"].as<string_t>() );
+            auto salt = encoder::base64::set( header["salt"].as<string_t>() );
+            if( key.size() != sizeof( seal.key ) || salt.size() != sizeof( seal.salt ) )
+              { return false; }
+
+            memcpy( seal.key, key.get(), key.size() ); memcpy( seal.salt, salt.get(), salt.size() );
+            OPENSSL_cleanse( key.get(), key.size() ); return true;
+        } catch( ... ) { return false; }
+    }
+
+    /* messages that share one wrapped header derive their own key from
+       a random per message salt, so chunk nonces never repeat */
+    static bool salt_seal( SEAL& seal, const char* salt, ulong size ) noexcept {
+        if( size != SALT ){ return false; } uchar buf[ wpgp::aead::KEY + SALT ];
+        memcpy( buf, seal.key, wpgp::aead::KEY ); memcpy( buf + wpgp::aead::KEY, salt, SALT );
+        wpgp::aead::digest( buf, sizeof( buf ), seal.key ); 
+        OPENSSL_cleanse( buf, sizeof( buf ) ); return true;
+    }
+
+    static bool salt_seal( SEAL& seal, const string_t& salt ) noexcept {
+        return salt_seal( seal, salt.get(), salt.size() );
+    }
+
+    /*─······································································─*/
+
+    /* Seals size bytes of in as ceil( size / chunk ) chunks of chunk bytes
+       each, numbered from index; chunk x is written to out + x*stride, where
+       stride defaults to chunk+TAG. When last is set, the final chunk is
+       tagged as the end of the stream. The AAD of every chunk is its final
+       mark and the envelope flag byte, so flags such as FLAG_ZIP cannot be
+       altered under the unkeyed envelope hash. */
+    static bool seal_chunks( const SEAL& seal, ullong index, const char* in, ulong size,
+                             ulong chunk, char* out, bool last, char flag, ulong stride=0 ) noexcept {
+        ulong count = size==0 ? 1 : ( size + chunk - 1 ) / chunk;
+        if( stride == 0 ){ stride = chunk + wpgp::aead::TAG; }
+        std::atomic<bool> done { true }; WPGP_STAGE( AEAD_SEAL, size );
+
+        wpgp::pool::get().run( count, [&]( ulong x ){
+            uchar nonce[ wpgp::aead::NONCE ]; uchar aad[2] = { uchar( last && x+1==count ), (uchar) flag };
+            ulong len = min( chunk, size - x * chunk ); wpgp::aead::nonce( nonce, seal.salt, index + x );
+            static thread_local wpgp::aead_t aead;
+            if( !aead.seal( seal.key, nonce, aad, 2, (uchar*) in + x * chunk, len,
+                                      (uchar*) out + x * stride ) )
+              { done = false; }
+        }); return done;
+    }
+
+    /* Opens every sealed chunk of tok, numbered from index, and writes their
+       plaintext back to back into out. */
+    static bool open_chunks( const SEAL& seal, ullong index, const array_t<string_t>& tok,
+                             char* out, bool last, char flag ) noexcept {
+        ulong count = tok.size(), pos = 0; std::vector<ITEM> item( count );
+
+        for( ulong x=0; x<count; x++ ){
+            if( tok[x].size() < wpgp::aead::TAG ){ return false; }
+            item[x].ptr = tok[x].get(); item[x].off = pos;
+            item[x].len = tok[x].size() - wpgp::aead::TAG; pos += item[x].len;
+        }   WPGP_STAGE( AEAD_OPEN, pos );
+
+        return open_items( seal, index, item.data(), count, out, last, flag );
+    }
+
+    /* an empty run is refused: a message must always end with the chunk
+       sealed as final, or its chunks could all be dropped unnoticed.
+       Chunks sealed before the flag byte joined the AAD carry { fin }
+       only; they are still accepted while the flag has no FLAG_ZIP, the
+       one bit those messages could not set, so the flag stays bound. */
+    static bool open_items( const SEAL& seal, ullong index, const ITEM* item, ulong count,
+                            char* out, bool last, char flag ) noexcept {
+        std::atomic<bool> done { true }; if( count == 0 ){ return false; }
+        wpgp::pool::get().run( count, [&]( ulong x ){
+            uchar nonce[ wpgp::aead::NONCE ]; uchar aad[2] = { uchar( last && x+1==count ), (uchar) flag };
+            wpgp::aead::nonce( nonce, seal.salt, index + x );
+            static thread_local wpgp::aead_t aead;
+            if( !aead.open( seal.key, nonce, aad, 2, (const uchar*) item[x].ptr, item[x].len,
+                            (uchar*) out + item[x].off ) && ( ( flag & FLAG_ZIP ) ||
+                !aead.open( seal.key, nonce, aad, 1, (const uchar*) item[x].ptr, item[x].len,
+                            (uchar*) out + item[x].off ) ) )
+              { done = false; }
+        }); return done;
+    }
+
+    static ulong open_size( const array_t<string_t>& tok ) noexcept { ulong size = 0;
+        for( auto& x : tok ){ size += x.size() < wpgp::aead::TAG ? 0 : x.size() - wpgp::aead::TAG; }
+        return size;
+    }
+
+    /*─······································································─*/
+
+    /* seekable messages are always chunked, by default in 64KB chunks */
+    bool  is_chunked() const noexcept { return obj->chunk > 0 || obj->seek; }
+    ulong chunk_size() const noexcept { return obj->chunk > 0 ? obj->chunk : 65536; }
+
+    string_t encrypt_chunked( const string_t& msg, SEAL seal, const string_t& header, char flag ) const {
+        if( obj->seek ){ flag |= FLAG_SEEK; } CTX ctx = new_ctx( FLAG_CHUNK | flag );
+        array_t<string_t> body; ulong chunk = chunk_size(); wpgp::seek::index_t idx;
+        ullong pos = sizeof( CTX ) + ( is_binary( ctx ) ? 0 : 1 ) + item_size( ctx, header.size() );
+
+        if( flag & FLAG_SALT ){ auto salt = string_t( SALT, '\0' );
+            if( !wpgp::aead::random( salt.get(), SALT ) ){ throw except_t( "Invalid WPGP message" ); }
+            salt_seal( seal, salt ); body.push( salt ); pos += item_size( ctx, SALT );
+        }
+
+        ulong count = msg.size()==0 ? 1 : ( msg.size() + chunk - 1 ) / chunk;
+        auto  buff  = string_t( msg.size() + count * wpgp::aead::TAG, '\0' );
+
+        bool  done  = seal_chunks( seal, 0, msg.get(), msg.size(), chunk, buff.get(), true, ctx.flag );
+        OPENSSL_cleanse( &seal, sizeof( SEAL ) ); if( !done ){ throw except_t( "Invalid WPGP message" ); }
+
+        for( ulong x=0; x<count; x++ ){ ulong off = x * ( chunk + wpgp::aead::TAG );
+             body.push( buff.slice( off, min( off + chunk + wpgp::aead::TAG, buff.size() ) ) );
+             idx.off.push_back( pos ); pos += item_size( ctx, body[ body.size()-1 ].size() );
+        }
+
+        if( flag & FLAG_SEEK ){ idx.chunk = chunk; idx.size = msg.size(); body.push( wpgp::seek::write( idx ) ); }
+        return envelope_to_memory( ctx, header, body );
+    }
+
+    string_t encrypt_chunked( const string_t& msg, char flag ) const noexcept {
+    try {
+        SEAL seal; auto header = seal_header( seal );
+        auto data = encrypt_chunked( msg, seal, header, flag );
+        OPENSSL_cleanse( &seal, sizeof( SEAL ) ); return data;
+    } catch(...) {
+        WPGP_ERROR( onError, "Invalid WPGP message" );
+        return nullptr;
+    }}
+
+    bool decrypt_chunked( const string_t& msg, const VIEW& view, const string_t& head, string_t& out ) const noexcept {
+        SEAL seal; auto tok = body_from_memory( msg, view );
+        if( !open_header( head, seal ) || !body_seal( view, tok, seal ) ){ return false; }
+
+        out = string_t( open_size( tok ), '\0' );
+        bool done = open_chunks( seal, 0, tok, out.get(), true, view.ctx.flag );
+        OPENSSL_cleanse( &seal, sizeof( SEAL ) ); return done;
+    }
+
+    /* drops the salt and index items of a chunked body off tok and
+       applies the salt to seal; seal is wiped when the body is malformed */
+    static bool body_seal( const VIEW& view, array_t<string_t>& tok, SEAL& seal ) noexcept {
+        if( view.ctx.flag & FLAG_SALT ){
+        if( tok.empty() || !salt_seal( seal, tok.shift() ) ){
+            OPENSSL_cleanse( &seal, sizeof( SEAL ) ); return false;
+        }}
+
+        if( view.ctx.flag & FLAG_SEEK ){ if( tok.size() < 2 ){
+            OPENSSL_cleanse( &seal, sizeof( SEAL ) ); return false;
+        }   tok.pop(); }
+
+        return true;
+    }
+
+    /* ECB body of a legacy message, given its unwrapped header */
+    bool decrypt_legacy( const string_t& msg, const VIEW& view, const string_t& key, string_t& out ) const noexcept {
+        try { auto header = parse_json( key ); if( !pass_zip( header, view.ctx ) ){ return false; }
+            auto sec    = header["pass"].as<string_t>();
+            auto body   = body_from_memory( msg, view );
+
+            WPGP_STAGE( AES, view.body[1] - view.body[0] );
+            auto dec = crypto::decrypt::AES_256_ECB( sec );
+            for( auto& x : body ){ dec.update( x ); }
+
+            out = dec.get(); return unzip_message( view.ctx, out );
+        } catch(...) { return false; }
+    }
+
+    /* Decrypts msg without emitting events or writing to the key state;
+       fprt selects the recipient slot of multi recipient messages. */
+    bool decrypt_from_memory( const string_t& msg, const string_t& fprt, string_t& out ) const noexcept {
+        VIEW view; if( !parse_from_memory( msg, view ) || !verify_from_memory( msg, view ) )
+          { return false; }
+
+        try { auto head = pick_header( view.ctx, decode_from_memory( msg, view, view.head ), fprt );
+            if( view.ctx.flag & FLAG_CHUNK )
+              { return decrypt_chunked( msg, view, head, out ) && unzip_message( view.ctx, out ); }
+            return decrypt_legacy( msg, view, unwrap_key( head ), out );
+        } catch(...) { return false; }
+    }
+
+    /*─······································································─*/
+
+    /* The _into calls write the chunked FLAG_SALT format straight into
+       caller memory. Outgoing messages share one wrapped session, as in
+       encrypt_messages, and incoming ones reuse the last session opened,
+       so after the first call neither path allocates for single chunk
+       messages; longer ones only pay for the worker pool dispatch. */
+
+    void reset_into() const noexcept { auto& s = obj->into;
+        OPENSSL_cleanse( s.seal, sizeof( s.seal ) ); s.open[0] = s.open[1] = 0;
+        s.head = nullptr; s.wrap = nullptr;
     }
 
+
+    bool into_session() const noexcept { auto& s = obj->into; if( s.open[0] ){ return true; }
+        try { s.ctx  = new_ctx( FLAG_CHUNK | FLAG_SALT );
+              s.head = head_to_memory( s.ctx, seal_header( s.seal[0] ) );
+              s.open[0] = !s.head.empty(); return s.open[0];
+        } catch(...) { return false; }
+    }
+
+    static ulong put_item( const CTX& ctx, const char* in, ulong size, char* out, bool last ) noexcept {
+        if( is_binary( ctx ) ){ put_uint32( out, size ); memcpy( out + 4, in, size ); return size + 4; }
+        WPGP_STAGE( MASK, size ); wpgp::kernel_t krn( ctx.mask, mask_size( ctx ) );
+        ulong len = krn.encode( in, size, out, true ); out[len] = last ? '.' : ':'; return len + 1;
+    }
+
+    static ulong item_size( const CTX& ctx, ulong size ) noexcept {
+        if( is_binary( ctx ) ){ return size + 4; }
+        wpgp::kernel_t krn; return krn.encode_size( size, true ) + 1;
+    }
+
+    /* envelope hash check shared by every in memory reader */
+    static bool check_hash( const string_t& data, const VIEW& view ) noexcept {
+        if( view.hash[1] - view.hash[0] != HASH ){ return false; } WPGP_STAGE( SHA256, view.hash[0] );
+        uchar sum[ HASH / 2 ]; char hex[ HASH ]; const char* raw = data.get() + view.hash[0];
+        wpgp::aead::digest( data.get(), view.hash[0], sum ); put_hex( sum, sizeof( sum ), hex );
+        return same_hex( hex, raw, HASH );
+    }
+
+    long encrypt_into( const string_t& msg, char* out, ulong size ) const noexcept {
+        ulong need = encrypt_size( msg.size() ); if( need == 0 || need > size ){ return -1; }
+        auto& s = obj->into; ulong chunk = chunk_size(), len = msg.size();
+        ulong count = len==0 ? 1 : ( len + chunk - 1 ) / chunk; bool bin = is_binary( s.ctx );
+
+        SEAL seal = s.seal[0]; char salt[ SALT ]; char* pos = out;
+        if( !wpgp::aead::random( salt, SALT ) ){ OPENSSL_cleanse( &seal, sizeof( SEAL ) ); return -1; }
+        salt_seal( seal, salt, SALT );
+
+        memcpy( pos, s.head.get(), s.head.size() ); pos += s.head.size();
+        pos += put_item( s.ctx, salt, SALT, pos, false );
+
+        bool done; if( bin ){
+            done = seal_chunks( seal, 0, msg.get(), len, chunk, pos + 4, true, s.ctx.flag, chunk + wpgp::aead::TAG + 4 );
+            for( ulong x=0; x<count; x++ ){ put_uint32( pos, min( chunk, len - x * chunk ) + wpgp::aead::TAG );
+                 pos += 4 + min( chunk, len - x * chunk ) + wpgp::aead::TAG;
+            }    put_uint32( pos, 0 ); put_uint32( pos + 4, HASH ); pos += 8;
+        } else {
+            if( s.buff.size() < len + count * wpgp::aead::TAG ){ s.buff.resize( len + count * wpgp::aead::TAG ); }
+            done = seal_chunks( seal, 0, msg.get(), len, chunk, s.buff.data(), true, s.ctx.flag );
+            for( ulong x=0; x<count; x++ ){ ulong off = x * ( chunk + wpgp::aead::TAG );
+                 pos += put_item( s.ctx, s.buff.data() + off, min( chunk, len - x * chunk ) + wpgp::aead::TAG, pos, x+1==count );
+            }    OPENSSL_cleanse( s.buff.data(), len + count * wpgp::aead::TAG );
+        }   OPENSSL_cleanse( &seal, sizeof( SEAL ) ); if( !done ){ return -1; }
+
+        uchar sum[ HASH / 2 ]; do { WPGP_STAGE( SHA256, pos - out );
+            wpgp::aead::digest( out, pos - out, sum );
+        } while(0); put_hex( sum, sizeof( sum ), pos ); return need;
+    }
+
+    /* opens the session of msg, or reuses the last one when msg carries
+       the very same wrapped header */
+    bool into_open( const string_t& msg, const VIEW& view, SEAL& seal ) const noexcept {
+        auto& s = obj->into; ulong len = view.head[1] - view.head[0];
+        if( s.open[1] && s.wrap.size() == len && memcmp( s.wrap.get(), msg.get() + view.head[0], len ) == 0 )
+          { seal = s.seal[1]; return true; }
+
+        try { if( !open_header( decode_from_memory( msg, view, view.head ), seal ) ){ return false; } }
+        catch(...) { return false; }
+
+        s.wrap = msg.slice( view.head[0], view.head[1] ); s.seal[1] = seal; s.open[1] = 1; return true;
+    }
+
+    long decrypt_into( const string_t& msg, char* out, ulong size ) const noexcept {
+        VIEW view; if( !parse_from_memory( msg, view ) || !check_hash( msg, view ) ){ return -1; }
+
+        if( ( view.ctx.flag & ( FLAG_CHUNK | FLAG_SALT | FLAG_MULTI | FLAG_ZIP | FLAG_SEEK ) ) != ( FLAG_CHUNK | FLAG_SALT ) ){
+            string_t data; if( !decrypt_from_memory( msg, obj->fprt, data ) || data.size() > size ){ return -1; }
+            memcpy( out, data.get(), data.size() ); return data.size();
+        }
+
+        auto& s = obj->into; bool bin = is_binary( view.ctx ); ulong pos = view.body[0], dec = 0, total = 0;
+        s.item.clear(); if( !bin && s.buff.size() < msg.size() ){ s.buff.resize( msg.size() ); }
+
+        if( bin ){ while( true ){
+            ulong len = get_uint32( msg.get() + pos ); pos += 4; if( len == 0 ){ break; }
+            s.item.push_back({ msg.get() + pos, len, 0 }); pos += len;
+        }} else { while( pos <= view.body[1] ){ WPGP_STAGE( MASK, view.body[1] - pos );
+            const char* end = (const char*) memchr( msg.get() + pos, ':', view.body[1] - pos );
+            ulong stop = end == nullptr ? view.body[1] : end - msg.get();
+            wpgp::kernel_t krn( view.ctx.mask, mask_size( view.ctx ) );
+            long len = krn.decode( msg.get() + pos, stop - pos, s.buff.data() + dec, true ); if( len < 0 ){ return -1; }
+            s.item.push_back({ s.buff.data() + dec, (ulong) len, 0 }); dec += len; pos = stop + 1;
+        }}
+
+        if( s.item.size() < 2 || s.item[0].len != SALT ){ return -1; }
+        for( ulong x=1; x<s.item.size(); x++ ){ auto& item = s.item[x];
+            if( item.len < wpgp::aead::TAG ){ return -1; }
+            item.len -= wpgp::aead::TAG; item.off = total; total += item.len;
+        }   if( total > size ){ return -1; }
+
+        SEAL seal; if( !into_open( msg, view, seal ) || !salt_seal( seal, s.item[0].ptr, SALT ) )
+          { OPENSSL_cleanse( &seal, sizeof( SEAL ) ); return -1; }
+
+        bool done; do { WPGP_STAGE( AEAD_OPEN, total );
+            done = open_items( seal, 0, s.item.data() + 1, s.item.size() - 1, out, true, view.ctx.flag );
+        } while(0); OPENSSL_cleanse( &seal, sizeof( SEAL ) ); return done ? (long) total : -1;
+    }
+
+    /*─······································································─*/
+
+    /* Locates the index of a seekable file from its end. Binary files end
+       with len index 0 len hash, where the index ends with its own length;
+       text files end with :index.hash, so the last ':' before the hash
+       starts it. stop receives the file offset of the index item. */
+    bool range_index( const wpgp::seek::reader_t& file, const CTX& ctx, ullong& stop, string_t& raw ) const noexcept {
+        ullong size = file.size(); if( size < sizeof( CTX ) + HASH + 16 ){ return false; }
+
+        if( is_binary( ctx ) ){ auto tail = file.read( size - HASH - 12, 12 ); if( tail.empty() ){ return false; }
+            ulong len = get_uint32( tail.get() ); if( get_uint32( tail.get() + 4 ) != 0 ||
+                get_uint32( tail.get() + 8 ) != HASH || len > size - HASH - 12 - sizeof( CTX ) ){ return false; }
+            stop = size - HASH - 12 - len; raw = file.read( stop, len + 4 );
+            if( raw.empty() || get_uint32( raw.get() ) != len ){ return false; }
+            raw = raw.slice( 4 ); return true;
+        }
+
+        ullong end = size - HASH - 1; if( file.read( end, 1 ) != "." ){ return false; }
+        for( ullong win=4096; true; win*=4 ){ ullong from = end > win ? end - win : 0;
+            auto data = file.read( from, end - from ); if( data.empty() ){ return false; }
+            for( ulong x=data.size(); x-->0; ){ if( data.get()[x] != ':' ){ continue; }
+                stop = from + x + 1; raw = mask_decode( ctx, data.get() + x + 1, data.size() - x - 1 );
+                return !raw.empty();
+            }   if( from == 0 ){ return false; }
+        }
+    }
+
+    bool read_range( const string_t& path, ullong offset, ulong length, string_t& out ) const noexcept {
+    try {
+        wpgp::seek::reader_t file( path ); ullong size = file.size();
+        if( !file.is_open() || size < sizeof( CTX ) + 2 ){ return false; }
+
+        CTX ctx; auto xtc = file.read( 0, sizeof( CTX ) ); memcpy( &ctx, xtc.get(), sizeof( CTX ) );
+        if( !is_valid( ctx ) || ( ctx.flag & ( FLAG_CHUNK | FLAG_SEEK ) ) != ( FLAG_CHUNK | FLAG_SEEK ) ){ return false; }
+        bool bin = is_binary( ctx ); string_t head; ullong body = 0;
+
+        if( bin ){ auto len = file.read( sizeof( CTX ), 4 ); if( len.empty() ){ return false; }
+            head = file.read( sizeof( CTX ) + 4, get_uint32( len.get() ) );
+            body = sizeof( CTX ) + 4 + get_uint32( len.get() );
+        } else for( ulong win=4096; head.empty(); win*=4 ){
+            auto data = file.read( sizeof( CTX ), min( (ullong) win, size - sizeof( CTX ) ) );
+            if( data.empty() || data.get()[0] != '.' ){ return false; }
+            auto end = (const char*) memchr( data.get() + 1, '.', data.size() - 1 );
+            if( end == nullptr ){ if( data.size() == size - sizeof( CTX ) ){ return false; } continue; }
+            head = mask_decode( ctx, data.get() + 1, end - data.get() - 1 ); if( head.empty() ){ return false; }
+            body = sizeof( CTX ) + ( end - data.get() ) + 1;
+        }
+
+        ullong stop; string_t raw; wpgp::seek::index_t idx; SEAL seal;
+        if( head.empty() || !range_index( file, ctx, stop, raw ) ||
+            !wpgp::seek::read( raw.get(), raw.size(), stop, idx ) || idx.off[0] < body ){ return false; }
+        if( !open_header( pick_header( ctx, head, obj->fprt ), seal ) ){ return false; }
+
+        if( ctx.flag & FLAG_SALT ){ auto salt = file.read( body, idx.off[0] - body );
+            salt = bin ? ( salt.size() < 4 ? nullptr : salt.slice( 4 ) ) : ( salt.empty() ? nullptr :
+                   mask_decode( ctx, salt.get(), salt.size() - 1 ) );
+            if( !salt_seal( seal, salt ) ){ OPENSSL_cleanse( &seal, sizeof( SEAL ) ); return false; }
+        }
+
+        if( offset >= idx.size || length == 0 ){ OPENSSL_cleanse( &seal, sizeof( SEAL ) ); out = string_t(); return true; }
+        length = min( (ullong) length, idx.size - offset ); ulong count = idx.off.size();
+        ulong k0 = offset / idx.chunk, k1 = ( offset + length - 1 ) / idx.chunk;
+        ullong from = idx.off[k0], to = k1+1 < count ? idx.off[k1+1] : stop;
+
+        auto data = file.read( from, to - from ); std::vector<ITEM> item;
+        auto buff = string_t( bin ? 0 : data.size(), '\0' ); ulong dec = 0, total = 0;
+        if( data.empty() ){ OPENSSL_cleanse( &seal, sizeof( SEAL ) ); return false; }
+
+        for( ulong k=k0; k<=k1; k++ ){ bool fail = false;
+            ullong a = idx.off[k] - from, b = ( k+1 < count ? idx.off[k+1] : stop ) - from;
+            ITEM it { nullptr, 0, total };
+            if( bin ){ fail = b - a < 4 || get_uint32( data.get() + a ) != b - a - 4;
+                it.ptr = data.get() + a + 4; it.len = b - a - 4;
+            } else { wpgp::kernel_t krn( ctx.mask, mask_size( ctx ) );
+                long len = data.get()[b-1] != ':' ? -1 : krn.decode( data.get() + a, b - a - 1, buff.get() + dec, true );
+                fail = len < 0; it.ptr = buff.get() + dec; it.len = fail ? 0 : len; dec += it.len;
+            }
+            /* the index is not authenticated, so every chunk must open to
+               exactly the size it implies or the slice below would shift */
+            ullong want = k+1 < count ? idx.chunk : idx.size - (ullong)( count-1 ) * idx.chunk;
+            if( fail || it.len < wpgp::aead::TAG || it.len - wpgp::aead::TAG != want )
+              { OPENSSL_cleanse( &seal, sizeof( SEAL ) ); return false; }
+            it.len -= wpgp::aead::TAG; total += it.len; item.push_back( it );
+        }
+
+        auto plain = string_t( total, '\0' ); bool done; do { WPGP_STAGE( AEAD_OPEN, total );
+            done = open_items( seal, k0, item.data(), item.size(), plain.get(), k1+1 == count, ctx.flag );
+        } while(0); OPENSSL_cleanse( &seal, sizeof( SEAL ) ); if( !done ){ return false; }
+
+        ulong skip = offset - (ullong) k0 * idx.chunk;
+        out = plain.slice( skip, skip + length ); return true;
+    } catch(...) { return false; } }
+
+    /*─······································································─*/
+
+    /* Writes the chunked message of the file at path to pathB, one BLOCK
+       window at a time: chunks are sealed straight from the source window
+       into the output block, framed in place and written with the head or
+       the tail in a single vectored write. */
+    bool file_to_file( const string_t& path, const string_t& pathB ) const noexcept {
+        wpgp::file::source_t src( path ); if( !src.is_open() ){ return false; }
+        wpgp::file::sink_t   out( pathB ); if( !out.is_open() ){ return false; }
+
+        SEAL seal; string_t head; CTX ctx = new_ctx( obj->seek ? FLAG_CHUNK | FLAG_SEEK : FLAG_CHUNK );
+        try { head = head_to_memory( ctx, seal_header( seal ) ); } catch(...) { return false; }
+
+        bool bin = is_binary( ctx ), fail = false, last = false; wpgp::sign::hash_t sha;
+        ulong chunk = chunk_size(), block = chunk * max( 1ul, (ulong) wpgp::file::BLOCK / chunk );
+        ullong size = src.size(), done = 0, index = 0, pos = head.size(); wpgp::seek::index_t idx;
+        std::vector<char> buff, scratch; sha.update( head.get(), head.size() );
+
+        while( !last && !fail ){ ulong take = min( (ullong) block, size - done ); last = done + take == size;
+            const char* in = src.next( take ); if( in == nullptr ){ fail = true; break; }
+            ulong count = take==0 ? 1 : ( take + chunk - 1 ) / chunk, used = 0;
+
+            if( bin ){ ulong stride = chunk + wpgp::aead::TAG + 4;
+                if( buff.size() < take + count * ( wpgp::aead::TAG + 4 ) ){ buff.resize( take + count * ( wpgp::aead::TAG + 4 ) ); }
+                fail = !seal_chunks( seal, index, in, take, chunk, buff.data() + 4, last, ctx.flag, stride );
+                for( ulong x=0; x<count; x++ ){ ulong len = min( chunk, take - x * chunk ) + wpgp::aead::TAG;
+                     idx.off.push_back( pos + used ); put_uint32( buff.data() + used, len ); used += len + 4;
+                }
+            } else {
+                if( scratch.size() < take + count * wpgp::aead::TAG ){ scratch.resize( take + count * wpgp::aead::TAG ); }
+                fail = !seal_chunks( seal, index, in, take, chunk, scratch.data(), last, ctx.flag ); ulong need = 0;
+                for( ulong x=0; x<count; x++ ){ need += item_size( ctx, min( chunk, take - x * chunk ) + wpgp::aead::TAG ); }
+                if( buff.size() < need ){ buff.resize( need ); }
+                for( ulong x=0; x<count && !fail; x++ ){ idx.off.push_back( pos + used );
+                     used += put_item( ctx, scratch.data() + x * ( chunk + wpgp::aead::TAG ),
+                             min( chunk, take - x * chunk ) + wpgp::aead::TAG, buff.data() + used,
+                             last && x+1==count && !obj->seek );
+                }
+            }   if( fail ){ break; }
+
+            do { WPGP_STAGE( SHA256, used ); sha.update( buff.data(), used ); } while(0);
+            wpgp::file::piece_t piece[2] = { { head.get(), index==0 ? head.size() : 0 }, { buff.data(), used } };
+            fail = !out.write( piece, 2 ); pos += used; done += take; index += count;
+        }
+
+        OPENSSL_cleanse( &seal, sizeof( SEAL ) ); if( fail ){ return false; }
+
+        string_t tail; if( obj->seek ){ idx.chunk = chunk; idx.size = size;
+            tail = item_to_memory( ctx, wpgp::seek::write( idx ), true );
+        }   tail += tail_to_memory( ctx ); sha.update( tail.get(), tail.size() );
+
+        uchar sum[ HASH / 2 ]; char hex[ HASH ]; sha.get( sum ); put_hex( sum, sizeof( sum ), hex );
+        wpgp::file::piece_t piece[2] = { { tail.get(), tail.size() }, { hex, HASH } };
+        return out.write( piece, 2 ) && out.close();
+    }
+
+    /*─······································································─*/
+
+    /* Flow control: bytes queued for a sink count as pending; above the
+       high watermark every pipe source stops reading until the sink has
+       drained them below the low watermark. */
+
+    void queue_bytes( ulong size ) const noexcept {
+        obj->pend += size; if( obj->pend >= obj->mark[0] ){ obj->hold = 1; }
+    }
+
+    void drain_bytes( ulong size ) const noexcept {
+        obj->pend -= min( size, obj->pend ); if( obj->pend <= obj->mark[1] ){ obj->hold = 0; }
+        if( obj->pend == 0 && obj->done ){ obj->done = 0; onClose.emit(); }
+    }
+
+    void begin_pipe() const noexcept { obj->pend = 0; obj->hold = 0; obj->done = 0; }
+
+    /* onClose waits for the sink to take every queued byte */
+    void end_pipe() const noexcept {
+        if( obj->pend == 0 ){ onClose.emit(); return; } obj->done = 1;
+    }
+
+    /* Reads file one piece per tick while the pipe is not paused; it
+       replaces stream::pipe, which would read the source without bound. */
+    template< class T, class U, class V >
+    void pump( const T& file, U data, V done ) const noexcept {
+        auto self = type::bind( this );
+        process::add([=](){
+            if( self->is_paused() ){ return 1; }
+            if( !file.is_available() ){ done(); return -1; }
+            auto dta = file.read(); if( !dta.empty() ){ data( dta ); } return 1;
+        });
+    }
+
+    /* Writes onData into fileB without blocking the event loop; what the
+       sink does not take yet stays queued and counts as pending. */
+    template< class V >
+    void sink_pipe( const V& fileB ) const noexcept {
+        struct QUEUE { queue_t<string_t> list; ulong pos=0; bool fail=0, end=0; };
+        ptr_t<QUEUE> que = new QUEUE(); auto self = type::bind( this );
+
+        onData([=]( string_t data ){
+            if( que->fail || data.empty() ){ return; }
+            que->list.push( data ); self->queue_bytes( data.size() );
+        });
+
+        /* a failed pipe or sink drops whatever is still queued */
+        onClose([=](){ que->end = 1; });
+        onError([=]( except_t ){ if( que->fail ){ return; }
+            que->fail = 1; que->list.clear(); self->drain_bytes( self->obj->pend );
+        });
+
+        process::add([=](){ if( que->fail ){ return -1; }
+            while( !que->list.empty() ){ auto data = que->list.first()->data;
+                int c = fileB._write( data.get() + que->pos, data.size() - que->pos );
+                if( c == -2 || c == 0 ){ return 1; }
+                if( c <  0 ){ WPGP_ERROR( self->onError, "Invalid WPGP sink" ); return -1; }
+                que->pos += c; if( que->pos == data.size() ){ que->pos = 0; que->list.shift(); }
+                self->drain_bytes( c );
+            }   return que->end ? -1 : 1;
+        });
+    }
+
+    template< class T >
+    string_t read_exact( const T& file, ulong size ) const {
+        string_t data; while( data.size() < size ){
+            auto dta = file.read( size - data.size() );
+            if ( dta.empty() ){ throw except_t( "Invalid WPGP message" ); } data += dta;
+        }   return data;
+    }
+
+    /* Streams the body of an envelope whose header was already consumed;
+       sink( piece, item_end, body_end ) receives the raw body pieces and
+       done( valid ) runs once the trailing hash was checked. */
+    template< class T, class U, class V >
+    void body_pipe( const T& file, const CTX& ctx, const string_t& prefix, U sink, V done ) const noexcept {
+        struct STREAM { string_t buff, hash; bool tail=0; };
+        ptr_t<STREAM> str = new STREAM(); bool bin = is_binary( ctx ); auto self = type::bind( this );
+        auto hash = crypto::hash::SHA256(); hash.update( prefix );
+
+        auto feed = [=]( const string_t& dta ){
+            if( str->tail ){ str->hash += dta; return; }
+
+            if( !bin ){ ulong pos = 0; while( pos < dta.size() ){
+                const char* raw = dta.get(); const char* end = raw + pos;
+                while( end < raw + dta.size() && *end != ':' && *end != '.' ){ ++end; }
+                ulong idx = end - raw; if( idx == dta.size() ){
+                    auto piece = dta.slice( pos ); hash.update( piece );
+                    sink( piece, false, false ); return;
+                }
+                auto piece = dta.slice( pos, idx ); hash.update( dta.slice( pos, idx + 1 ) );
+                pos = idx + 1; if( *end == ':' ){ sink( piece, true, false ); continue; }
+                str->tail = 1; str->hash = dta.slice( pos ); sink( piece, true, true ); return;
+            }   return; }
+
+            str->buff += dta; while( str->buff.size() >= 4 ){
+                ulong len = get_uint32( str->buff.get() ); if( str->buff.size() - 4 < len ){ return; }
+                hash.update( str->buff.slice( 0, 4 + len ) ); if( len == 0 ){
+                    str->tail = 1; str->hash = str->buff.slice( 4 ); str->buff = nullptr;
+                    sink( nullptr, false, true ); return;
+                }   sink( str->buff.slice( 4, 4 + len ), true, false ); str->buff = str->buff.slice( 4 + len );
+            }
+        };
+
+        file.onDrain([=](){ bool valid = str->tail;
+            if( valid && bin ){
+                valid = str->hash.size() >= 4 && get_uint32( str->hash.get() ) == str->hash.size() - 4;
+                if( valid ){ hash.update( str->hash.slice( 0, 4 ) ); str->hash = str->hash.slice( 4 ); }
+            }   auto sum = valid ? hash.get() : string_t();
+            done( valid && str->hash.size() == sum.size() && same_hex( str->hash.get(), sum.get(), sum.size() ) );
+        });
+
+        process::add([=](){
+            if( self->is_paused() ){ return 1; }
+            if( !file.is_available() ){ return -1; }
+        coStart
+
+            while( true ){ do {
+                feed( file.read() );
+            } while(0); coNext; }
+
+        coStop
+        });
+    }
+
+    /*─······································································─*/
+
+    template< class T >
+    void encrypt_chunked_pipe( const T& file ) const noexcept {
+        struct STREAM { CTX ctx; SEAL seal; string_t buff; ullong index=0, pos=0; bool fail=0; wpgp::seek::index_t idx; };
+        ptr_t<STREAM> str = new STREAM(); str->ctx = new_ctx( obj->seek ? FLAG_CHUNK | FLAG_SEEK : FLAG_CHUNK );
+        bool seek = obj->seek;
+
+        auto sha = crypto::hash::SHA256();
+        auto self= type::bind( this );
+        string_t header;
+
+        try { header = seal_header( str->seal ); } catch(...) {
+            WPGP_ERROR( onError, "Invalid WPGP message" ); return;
+        }
+
+        auto flush = [=]( bool last ){ if( str->fail ){ return; }
+            ulong chunk = self->chunk_size(), size = str->buff.size();
+            ulong count = last ? max( 1ul, ( size + chunk - 1 ) / chunk ) : ( size - 1 ) / chunk;
+            ulong take  = last ? size : count * chunk; if( count == 0 ){ return; }
+
+            auto buff = string_t( take + count * wpgp::aead::TAG, '\0' );
+            if( !seal_chunks( str->seal, str->index, str->buff.get(), take, chunk, buff.get(), last, str->ctx.flag ) ){
+                str->fail = 1; WPGP_ERROR( self->onError, "Invalid WPGP message" ); return;
+            }
+
+            for( ulong x=0; x<count; x++ ){ ulong pos = x * ( chunk + wpgp::aead::TAG );
+                auto data = self->item_to_memory( str->ctx, buff.slice(
+                     pos, min( pos + chunk + wpgp::aead::TAG, buff.size() )
+                ), last && x+1==count && !seek ); sha.update( data ); self->onData.emit( data );
+                str->idx.off.push_back( str->pos ); str->pos += data.size();
+            }
+
+            str->index += count; str->idx.size += take; str->buff = str->buff.slice( take );
+        };
+
+        ptr_t<ZIP> zip = new ZIP(); begin_pipe();
+
+        auto head = [=]( const string_t& data ){ if( zip->head ){ return; }
+            self->zip_head( *zip, str->ctx, data ); auto out = self->head_to_memory( str->ctx, header );
+            sha.update( out ); self->onData.emit( out ); str->pos += out.size();
+        };
+
+        pump( file, [=]( string_t data ){ head( data ); str->buff += zip_data( *zip, data, false );
+            if( str->buff.size() > self->chunk_size() * wpgp::pool::get().size() ){ flush( false ); }
+        }, [=](){ head( nullptr ); if( zip->fd.is_active() ){ str->buff += zip_data( *zip, nullptr, true ); }
+            if( zip->fd.is_failed() && !str->fail ){ str->fail = 1; WPGP_ERROR( self->onError, "Invalid WPGP message" ); }
+            flush( true );
+            OPENSSL_cleanse( &str->seal, sizeof( SEAL ) ); if( !str->fail ){
+                if( seek ){ str->idx.chunk = self->chunk_size();
+                    auto data = self->item_to_memory( str->ctx, wpgp::seek::write( str->idx ), true );
+                    sha.update( data ); self->onData.emit( data );
+                }
+                auto data = self->tail_to_memory( str->ctx ); sha.update( data );
+                self->onData.emit( data + sha.get() );
+            }   self->end_pipe();
+        });
+    }
+
+    template< class T >
+    void decrypt_chunked_pipe( const T& file, const CTX& ctx, const string_t& prefix, const string_t& rdh ) const noexcept {
+        struct STREAM { SEAL seal; string_t buff; array_t<string_t> tok; ullong index=0; bool fail=0, salt=0, fin=0; };
+        ptr_t<STREAM> str = new STREAM(); auto self = type::bind( this ); bool bin = is_binary( ctx );
+        ulong keep = ctx.flag & FLAG_SEEK ? 2 : 1; // the final chunk, and the index after it
+        str->salt = ctx.flag & FLAG_SALT; ptr_t<ZIP> zip = new ZIP();
+        if( ctx.flag & FLAG_ZIP ){ zip->fd.start( true ); zip->fd.limit( obj->inflate ); }
+
+        if( !open_header( rdh, str->seal ) )
+          { WPGP_ERROR( onError, "Invalid WPGP message" ); return; }
+
+        auto flush = [=]( bool last ){ if( str->fail || str->tok.empty() ){ return; }
+            array_t<string_t> tok = str->tok; str->tok = array_t<string_t>();
+
+            if( str->salt ){ str->salt = 0; if( !salt_seal( str->seal, tok.shift() ) ){
+                str->fail = 1; WPGP_ERROR( self->onError, "Invalid WPGP message" ); return;
+            }}
+
+            if( !last ){ ulong cut = tok.size() > keep ? tok.size() - keep : 0;
+                for( ulong x=cut; x<tok.size(); x++ ){ str->tok.push( tok[x] ); }
+                while( tok.size() > cut ){ tok.pop(); }
+            } else if( keep == 2 ){ if( tok.empty() ){
+                str->fail = 1; WPGP_ERROR( self->onError, "Invalid WPGP message" ); return;
+            }   tok.pop(); }  if( tok.empty() ){ return; }
+
+            auto data = string_t( open_size( tok ), '\0' );
+            if( !open_chunks( str->seal, str->index, tok, data.get(), last, ctx.flag ) ){
+                str->fail = 1; WPGP_ERROR( self->onError, "Invalid WPGP message" ); return;
+            }   str->index += tok.size(); str->fin = last; data = unzip_data( *zip, data );
+            if( !data.empty() ){ self->onData.emit( data ); }
+        };
+
+        body_pipe( file, ctx, prefix, [=]( string_t piece, bool item_end, bool body_end ){
+            if( !bin ){ str->buff += piece; if( item_end ){
+                str->tok.push( mask_decode( ctx, str->buff.get(), str->buff.size() ) );
+                str->buff = nullptr;
+            }} else if( item_end ){ str->tok.push( piece ); }
+            if( body_end ){ flush( true ); }
+            else if( str->tok.size() > wpgp::pool::get().size() ){ flush( false ); }
+        }, [=]( bool valid ){
+            OPENSSL_cleanse( &str->seal, sizeof( SEAL ) );
+            if( !str->fail && !( valid && str->fin && unzip_done( *zip ) ) ){ WPGP_ERROR( self->onError, "Invalid WPGP message" ); }
+            self->end_pipe();
+        });
+    }
+
+    /*─······································································─*/
+
+    /* parsed key for signatures, built from the PEM key on first use and
+       then shared read only, also by batch verification workers */
+    EVP_PKEY* sign_key() const noexcept {
+        if( obj->evp != nullptr || obj->ec ){ return obj->evp; }
+        if( !obj->prvt ){ obj->evp = wpgp::sign::load( obj->pkey.get(), obj->pkey.size() ); return obj->evp; }
+        auto pem = obj->fd.write_private_key_to_memory( nullptr );
+        obj->evp = wpgp::sign::load( pem.get(), pem.size() );
+        OPENSSL_cleanse( pem.get(), pem.size() ); return obj->evp;
+    }
+
+    string_t sign_json() const noexcept {
+        return json::stringify( object_t({ { "type", "SIGNATURE" }, { "hash", "SHA256" },
+               { "fingerprint", obj->fprt }, { "time", process::seconds() } }) );
+    }
+
+    /* the key signs SHA256( SHA256( msg ) || header ), which binds the
+       signature header to the message digest */
+    static void sign_digest( const uchar* digest, const char* header, ulong size, uchar* out ) noexcept {
+        wpgp::sign::hash_t sha; sha.update( digest, wpgp::sign::DIGEST );
+        sha.update( header, size ); sha.get( out );
+    }
+
+    string_t sign_to_memory( const uchar* digest ) const noexcept {
+        EVP_PKEY* key = obj->prvt ? sign_key() : nullptr; if( key == nullptr ){ return nullptr; }
+        auto  header = sign_json(); uchar fin[ wpgp::sign::DIGEST ];
+        sign_digest( digest, header.get(), header.size(), fin );
+
+        ulong size = EVP_PKEY_size( key ); auto sig = string_t( size, '\0' );
+        do { WPGP_STAGE( RSA_SIGN, size );
+             if( !wpgp::sign::sign( key, fin, (uchar*) sig.get(), size ) ){ return nullptr; }
+        } while(0);
+
+        return envelope_to_memory( new_ctx( FLAG_SIGN ), header,
+               array_t<string_t>({ size == sig.size() ? sig : sig.slice( 0, size ) }) );
+    }
+
+    /* splits a signature envelope made by this key into its header and
+       raw signature */
+    bool open_signature( const string_t& sig, string_t& header, string_t& raw ) const noexcept {
+        VIEW view; if( !parse_from_memory( sig, view ) || !verify_from_memory( sig, view ) ||
+                       !( view.ctx.flag & FLAG_SIGN ) ){ return false; }
+        try { header = decode_from_memory( sig, view, view.head );
+            auto body = body_from_memory( sig, view ); auto data = parse_json( header );
+            if( body.size() != 1 || data["type"].as<string_t>() != "SIGNATURE" ||
+                data["fingerprint"].as<string_t>() != obj->fprt ){ return false; }
+            raw = body[0]; return true;
+        } catch(...) { return false; }
+    }
+
+    bool verify_digest( const uchar* digest, const string_t& sig ) const noexcept {
+        string_t header, raw; EVP_PKEY* key = sign_key();
+        if( key == nullptr || !open_signature( sig, header, raw ) ){ return false; }
+        uchar fin[ wpgp::sign::DIGEST ]; sign_digest( digest, header.get(), header.size(), fin );
+        WPGP_STAGE( RSA_VERIFY, raw.size() );
+        return wpgp::sign::verify( key, fin, (uchar*) raw.get(), raw.size() );
+    }
+
+    /*─······································································─*/
+
     bool verify( const string_t& path ) const noexcept {
-        try { 
-            file_t file ( path, "r" ); 
+        try {
+            file_t file ( path, "r" );
             auto data = stream::await( file );
             return verify_from_memory( data );
         } catch( ... ) { return false; }
     }
 
-public: 
+public:
 
     event_t<except_t> onError;
     event_t<>         onClose;
@@ -105,12 +1398,39 @@ public:
 
     /*─······································································─*/
 
+    /* size is the RSA modulus size, or 25519 for an X25519 key */
     void create_new_user( string_t _name, string_t _mail, string_t _cmmt, uint max_age=0, uint size=1024 ) const noexcept {
-        if( max_age == 0 ) { obj->stmp[0] = 0; obj->stmp[1] = 0; } else { 
-            obj->stmp[0] = process::seconds() / 86400;
-            obj->stmp[1] = min( max_age, 365u );
-        }   obj->fd = crypto::encrypt::RSA(); obj->fd.generate_keys( size ); 
-        obj->size = size; obj->name = _name; obj->mail = _mail; obj->cmmt = _cmmt; obj->prvt = true;
+        std::string pem; obj->fd = crypto::encrypt::RSA(); obj->ec = size == wpgp::ecc::SIZE;
+
+        if( obj->ec ){ do { WPGP_STAGE( KEYGEN, size );
+            if( !wpgp::ecc::generate( obj->ecc[0], obj->ecc[1] ) ){ obj->ec = 0; }
+        } while(0); if( !obj->ec ){ WPGP_ERROR( onError, "Invalid WPGP Key" ); return; }
+            set_user( _name, _mail, _cmmt, max_age, size ); return;
+        }
+
+        if( wpgp::keygen::take( size, pem ) ){ set_user_key( pem ); }
+        else { WPGP_STAGE( KEYGEN, size ); obj->fd.generate_keys( size ); }
+        set_user( _name, _mail, _cmmt, max_age, size );
+    }
+
+    /* generates the key on the worker pool and calls cb once it is ready,
+       so the event loop keeps running while large keys are generated */
+    void create_new_user_async( string_t _name, string_t _mail, string_t _cmmt, uint max_age, uint size, function_t<void,wpgp_t> cb ) const noexcept {
+        auto self = type::bind( this ); auto pem = std::make_shared<std::string>();
+
+        if( size == wpgp::ecc::SIZE ){ create_new_user( _name, _mail, _cmmt, max_age, size );
+            wpgp::pool::async( [](){}, [=](){ if( self->obj->ec ){ cb( *self ); } }); return;
+        }
+
+        auto done = [=](){ if( pem->empty() ){ WPGP_ERROR( self->onError, "Invalid WPGP Key" ); return; }
+            self->obj->fd = crypto::encrypt::RSA(); self->obj->ec = 0; self->set_user_key( *pem );
+            self->set_user( _name, _mail, _cmmt, max_age, size ); cb( *self );
+        };
+
+        if( wpgp::keygen::take( size, *pem ) ){ wpgp::pool::async( [](){}, done ); return; }
+        auto stop = &wpgp::pool::get().stopped(); wpgp::pool::async( [=](){
+            wpgp::keygen::cancel_t cancel; cancel.flag[0] = stop; wpgp::keygen::generate( size, *pem, &cancel );
+        }, done );
     }
 
     /*─······································································─*/
@@ -120,89 +1440,83 @@ public:
     string_t get_comment() const noexcept { return obj->cmmt; }
     uint* get_expiration() const noexcept { return obj->stmp; }
     ulong get_size()       const noexcept { return obj->size; }
+    string_t get_fingerprint() const noexcept { return obj->fprt; }
 
     /*─······································································─*/
 
-    void write_private_key( const string_t& path, const string_t& pass=nullptr ) const {
-        auto file = fs::writable( path ); file.write( write_private_key_to_memory( pass ) );
-    }
+    void set_chunk_size( ulong size ) const noexcept { obj->chunk = size; }
+    ulong get_chunk_size() const noexcept { return obj->chunk; }
 
-    string_t write_private_key_to_memory( const string_t& pass=nullptr ) const noexcept {
-        CTX ctx; memcpy( &ctx.mask, encoder::key::generate( 4 ).get(), 5 );
-        
-        auto sha    = crypto::hash::SHA256(); 
-        auto body   = obj->fd.write_private_key_to_memory( pass.get() );
-             body   = encoder::base64::get( encoder::XOR::get( body, ctx.mask ) );
+    void set_format( const string_t& format ) const noexcept { obj->bin = format == "WPGB"; reset_into(); }
+    string_t get_format()  const noexcept { return obj->bin ? "WPGB" : "WPGP"; }
 
-        auto header = encoder::base64::get( encoder::XOR::get( json::stringify( object_t({
-            { "name", obj->name }, { "mail", obj->mail }, { "comment", obj->cmmt },
-            { "expiration", array_t<uint>({ obj->stmp[0], obj->stmp[1] }) },
-            { "size", obj->size }, { "type", "PRIVATE" }
-        })), ctx.mask ));
+    /* keeps up to size unwrapped session headers, keyed by a digest of
+       their wrapped form, so that repeated headers skip RSA or ECDH; 0
+       turns it off. Entries are wiped on eviction and on free() */
+    void set_key_cache( ulong size ) const noexcept {
+        std::lock_guard<std::mutex> guard( obj->lock );
+        obj->keys.clear(); obj->keys = wpgp::lru_t<UNWRAP>( size, &UNWRAP::drop );
+    }
 
-        auto data = string_t( (char*)& ctx, sizeof( CTX ) ) + ".";
-             data+= header + "." + body + "."; 
-        sha.update( data ); data += sha.get(); 
-        
-        return data;
+    ulong get_key_cache() const noexcept {
+        std::lock_guard<std::mutex> guard( obj->lock ); return obj->keys.capacity();
     }
 
-    /*─······································································─*/
+    /* seekable messages are chunked and end with a block index that
+       decrypt_range uses; they are never compressed */
+    void set_seekable( bool seek ) const noexcept { obj->seek = seek; }
+    bool is_seekable() const noexcept { return obj->seek; }
 
-    void write_public_key( const string_t& path ) const {
-        auto file = fs::writable( path ); file.write( write_public_key_to_memory() );
-    }
+    /* largest plaintext a compressed message may inflate to, counted over
+       the whole message in memory and over the whole stream in pipes;
+       0 turns the limit off */
+    void set_inflate_limit( ulong size ) const noexcept { obj->inflate = size; }
+    ulong get_inflate_limit() const noexcept { return obj->inflate; }
 
-    string_t write_public_key_to_memory() const noexcept { 
-        CTX ctx; memcpy( &ctx.mask, encoder::key::generate( 4 ).get(), 5 );
-        
-        auto sha    = crypto::hash::SHA256(); 
-        auto body   = obj->fd.write_public_key_to_memory();
-             body   = encoder::base64::get( encoder::XOR::get( body, ctx.mask ) );
+    /* deflate level 1-9 applied before encryption, 0 turns it off */
+    void set_compression( uint level ) const noexcept { obj->zip = min( level, 9u ); }
+    uint get_compression() const noexcept { return obj->zip; }
 
-        auto header = encoder::base64::get( encoder::XOR::get( json::stringify( object_t({
-            { "name", obj->name }, { "mail", obj->mail }, { "comment", obj->cmmt },
-            { "expiration", array_t<uint>({ obj->stmp[0], obj->stmp[1] }) },
-            { "size", obj->size }, { "type", "PUBLIC" }
-        })), ctx.mask ));
+    /*─······································································─*/
 
-        auto data = string_t( (char*)& ctx, sizeof( CTX ) ) + ".";
-             data+= header + "." + body + ".";
-        sha.update( data ); data += sha.get();
-        
-        return data;
+    /* pipes stop reading their source once high bytes wait for the sink
+       and resume below low; low defaults to a quarter of high */
+    void set_watermark( ulong high, ulong low=0 ) const noexcept {
+        obj->mark[0] = max( high, 1ul ); obj->mark[1] = low==0 ? obj->mark[0] / 4 : min( low, obj->mark[0] );
     }
 
+    ulong get_pending() const noexcept { return obj->pend; }
+
+    /* lets onData consumers with their own buffers stop the pipe source */
+    void pause()  const noexcept { obj->stop = 1; }
+    void resume() const noexcept { obj->stop = 0; }
+    bool is_paused() const noexcept { return obj->stop || obj->hold; }
+
     /*─······································································─*/
 
-    void read_private_key_from_memory( const string_t& pkey, const string_t& pass=nullptr ) const {
-        if( !verify_from_memory( pkey ) ){ _EERROR( onError, "Invalid WPGP Key" ); return; }
-        
-        CTX ctx; memcpy( &ctx, pkey.get(), sizeof( CTX ) );
+    void write_private_key( const string_t& path, const string_t& pass=nullptr ) const {
+        auto file = fs::writable( path ); file.write( write_private_key_to_memory( pass ) );
+    }
 
-        auto pos = regex::search_all( pkey, "[^.]+" ); pos.shift();
-        if ( pos.empty() ){ return; }
-        
-        auto header = json::parse( encoder::XOR::get( encoder::base64::set( 
-             pkey.slice( pos[0][0], pos[0][1] )
-        ), ctx.mask ));
+    string_t write_private_key_to_memory( const string_t& pass=nullptr ) const noexcept {
+        if( obj->ec ){ return write_key_to_memory( "PRIVATE", write_ecc_key( pass ) ); }
+        return write_key_to_memory( "PRIVATE", obj->fd.write_private_key_to_memory( pass.get() ) );
+    }
 
-        auto body = encoder::XOR::get( encoder::base64::set( 
-             pkey.slice( pos[1][0], pos[1][1] )
-        ), ctx.mask );
+    /*─······································································─*/
 
-        if( header["type"].as<string_t>() != "PRIVATE" )
-          { _EERROR( onError, "Invalid WPGP Key" ); return; }
+    void write_public_key( const string_t& path ) const {
+        auto file = fs::writable( path ); file.write( write_public_key_to_memory() );
+    }
 
-        obj->prvt    = true;
-        obj->size    = header["size"].as<uint>();
-        obj->name    = header["name"].as<string_t>();
-        obj->mail    = header["mail"].as<string_t>();
-        obj->cmmt    = header["comment"].as<string_t>();
-        obj->stmp[0] = header["expiration"][0].as<int>();
-        obj->stmp[1] = header["expiration"][1].as<int>();
+    string_t write_public_key_to_memory() const noexcept {
+        return write_key_to_memory( "PUBLIC", obj->pkey );
+    }
+
+    /*─······································································─*/
 
-        obj->fd.read_private_key_from_memory( body, pass.get() );
+    void read_private_key_from_memory( const string_t& pkey, const string_t& pass=nullptr ) const {
+        read_key_from_memory( pkey, "PRIVATE", pass );
     }
 
     void read_private_key( const string_t& path, const string_t& pass=nullptr ) const {
@@ -213,33 +1527,7 @@ public:
     /*─······································································─*/
 
     void read_public_key_from_memory( const string_t& pkey ) const {
-        if( !verify_from_memory( pkey ) ){ _EERROR( onError, "Invalid WPGP Key" ); return; }
-        
-        CTX ctx; memcpy( &ctx, pkey.get(), sizeof( CTX ) );
-
-        auto pos = regex::search_all( pkey, "[^.]+" ); pos.shift();
-        if ( pos.empty() ){ return; }
-        
-        auto header = json::parse( encoder::XOR::get( encoder::base64::set( 
-             pkey.slice( pos[0][0], pos[0][1] )
-        ), ctx.mask ));
-
-        auto body = encoder::XOR::get( encoder::base64::set( 
-             pkey.slice( pos[1][0], pos[1][1] )
-        ), ctx.mask );
-
-        if( header["type"].as<string_t>() != "PUBLIC" )
-          { _EERROR( onError, "Invalid WPGP Key" ); return; }
-
-        obj->prvt    = false;
-        obj->size    = header["size"].as<uint>();
-        obj->name    = header["name"].as<string_t>();
-        obj->mail    = header["mail"].as<string_t>();
-        obj->cmmt    = header["comment"].as<string_t>();
-        obj->stmp[0] = header["expiration"][0].as<int>();
-        obj->stmp[1] = header["expiration"][1].as<int>();
-
-        obj->fd.read_public_key_from_memory( body );
+        read_key_from_memory( pkey, "PUBLIC", nullptr );
     }
 
     void read_public_key( const string_t& path ) const {
@@ -249,167 +1537,400 @@ public:
 
     /*─······································································─*/
 
-    string_t encrypt_message( const string_t& msg ) const noexcept { 
-        CTX ctx; auto sec = crypto::hash::SHA256();
-                 auto sha = crypto::hash::SHA256();
-
-        memcpy( &ctx.mask, encoder::key::generate( 4 ).get(), 5 );
+    /* a copy that owns its key material and settings, so later changes
+       to this object never reach it; the events are still shared */
+    wpgp_t snapshot() const noexcept { wpgp_t out( *this ); out.obj = new NODE(); auto& dst = *out.obj;
+        dst.size  = obj->size;  dst.prvt = obj->prvt; dst.name = obj->name; dst.mail = obj->mail;
+        dst.cmmt  = obj->cmmt;  memcpy( dst.stmp, obj->stmp, sizeof( dst.stmp ) ); dst.ec = obj->ec;
+        dst.chunk = obj->chunk; dst.bin  = obj->bin;  dst.zip  = obj->zip;  dst.inflate = obj->inflate;
+        dst.seek  = obj->seek;  memcpy( dst.mark, obj->mark, sizeof( dst.mark ) );
+        dst.keys  = wpgp::lru_t<UNWRAP>( get_key_cache(), &UNWRAP::drop );
+
+        if( obj->ec ){ memcpy( dst.ecc, obj->ecc, sizeof( dst.ecc ) ); }
+        else if( obj->prvt ){ auto pem = obj->fd.write_private_key_to_memory( nullptr );
+            dst.fd.read_private_key_from_memory( pem, nullptr ); OPENSSL_cleanse( pem.get(), pem.size() );
+        } else if( !obj->pkey.empty() ){ dst.fd.read_public_key_from_memory( obj->pkey ); }
+
+        out.cache_key(); return out;
+    }
 
-        sec.update( string::to_string( rand() ) );
-        sec.update( string::to_string( process::now() ) );
-        sec.update( obj->fd.write_public_key_to_memory() );
+    /*─······································································─*/
 
-        auto enc = crypto::encrypt::AES_256_ECB( sec.get() );
-                   enc.update( msg );
-        
-        auto body= encoder::base64::get( encoder::XOR::get( 
-             enc.get(), ctx.mask
-        ));
+    string_t encrypt_message( const string_t& msg ) const noexcept {
+        auto data = msg; char flag = zip_message( data );
+        if( is_chunked() ){ return encrypt_chunked( data, flag ); }
 
-        auto header = encoder::base64::get( encoder::XOR::get(
-             obj->fd.public_encrypt( json::stringify( object_t({
-                { "type", "MESSAGE" }, { "pass", sec.get() }
-             }))
-        ), ctx.mask ));
+        CTX ctx = new_ctx( flag ); auto sec = new_pass();
 
-        auto data = string_t( (char*)& ctx, sizeof( CTX ) ) + ".";
-             data+= header + "." + body + ".";
-        sha.update( data ); data += sha.get(); 
-        
-        return data;
+        return envelope_to_memory( ctx, pass_header( sec, flag ), array_t<string_t>({ ecb_encrypt( sec, data ) }) );
     }
 
+    /* Encrypts every message of msg under a single wrapped session key,
+       so the batch costs one RSA operation instead of one per message. */
+    array_t<string_t> encrypt_messages( const array_t<string_t>& msg ) const noexcept {
+        array_t<string_t> out; SEAL seal; if( msg.empty() ){ return out; }
+    try {
+
+        /* always chunked: each message derives its own key from a random
+           salt, where one shared ECB key would repeat ciphertext blocks */
+        auto header = seal_header( seal );
+        for( auto& x : msg ){ auto data = x; char flag = zip_message( data );
+             out.push( encrypt_chunked( data, seal, header, FLAG_SALT | flag ) );
+        }
+        OPENSSL_cleanse( &seal, sizeof( SEAL ) ); return out;
+
+    } catch(...) { OPENSSL_cleanse( &seal, sizeof( SEAL ) );
+        WPGP_ERROR( onError, "Invalid WPGP message" );
+        return array_t<string_t>();
+    }}
+
+    /* Encrypts msg once for every key of list; each recipient finds its
+       own wrapped session key in the header by fingerprint. */
+    string_t encrypt_message( const string_t& msg, const array_t<wpgp_t>& list ) const noexcept {
+    try {
+
+        auto body = msg; char flag = zip_message( body );
+
+        if( is_chunked() ){ SEAL seal; auto header = multi_header( seal_json( seal ), list );
+            auto data = encrypt_chunked( body, seal, header, FLAG_MULTI | flag );
+            OPENSSL_cleanse( &seal, sizeof( SEAL ) ); return data;
+        }
+
+        CTX ctx = new_ctx( FLAG_MULTI | flag ); auto sec = new_pass();
+        return envelope_to_memory( ctx, multi_header( pass_json( sec, flag ), list ),
+                                   array_t<string_t>({ ecb_encrypt( sec, body ) }) );
+
+    } catch(...) {
+        WPGP_ERROR( onError, "Invalid WPGP message" );
+        return nullptr;
+    }}
+
     template< class T >
     void encrypt_pipe( const T& file ) const noexcept {
-        CTX ctx ; memcpy( ctx.mask, encoder::key::generate(4).get(), 5 );
+        if( is_chunked() ){ encrypt_chunked_pipe( file ); return; }
 
-        auto XOR = crypto::encrypt::XOR( ctx.mask );
-        auto b64 = crypto::encoder::BASE64();
-        auto sec = crypto::hash::SHA256();
+        CTX ctx = new_ctx( 0 ); bool bin = is_binary( ctx );
+
+        ptr_t<wpgp::kernel_t> krn = new wpgp::kernel_t( ctx.mask, mask_size( ctx ) );
+        auto sec = new_pass();
         auto sha = crypto::hash::SHA256();
         auto self= type::bind( this );
 
-        sec.update( string::to_string( rand() ) );
-        sec.update( string::to_string( process::now() ) );
-        sec.update( obj->fd.write_public_key_to_memory() );
+        auto enc = crypto::encrypt::AES_256_ECB( sec );
 
-        auto enc = crypto::encrypt::AES_256_ECB( sec.get() );
-
-        file.onData([=]( string_t data ){ enc.update( data ); });
-        enc .onData([=]( string_t data ){ XOR.update( data ); });
-        XOR .onData([=]( string_t data ){ b64.update( data ); });
-        b64 .onData([=]( string_t data ){
-            self->onData.emit( data ); 
-            sha.update( data );
+        enc.onData([=]( string_t data ){ if( data.empty() ){ return; }
+            if( bin ){ data = self->item_to_memory( ctx, data, false ); } else {
+                WPGP_STAGE( MASK, data.size() ); auto out = string_t( krn->encode_size( data.size(), false ), '\0' );
+                if( out.empty() ){ krn->encode( data.get(), data.size(), nullptr, false ); return; }
+                krn->encode( data.get(), data.size(), out.get(), false ); data = out;
+            }   self->onData.emit( data ); sha.update( data );
         });
 
-        file.onClose([=](){ 
-            enc.free(); b64.free(); sha.update( "." );
-            self->onData.emit( "." + sha.get() );
-            self->onClose.emit();
+        ptr_t<ZIP> zip = new ZIP(); begin_pipe();
+
+        auto head = [=]( const string_t& data ){ if( zip->head ){ return; } CTX tmp = ctx;
+            self->zip_head( *zip, tmp, data ); auto header = self->pass_header( sec, tmp.flag & FLAG_ZIP );
+            auto out = self->head_to_memory( tmp, header ); sha.update( out ); self->onData.emit( out );
+        };
+
+        pump( file, [=]( string_t data ){ head( data );
+            data = zip_data( *zip, data, false ); if( !data.empty() ){ enc.update( data ); }
+        }, [=](){ head( nullptr ); if( zip->fd.is_active() ){
+                auto data = zip_data( *zip, nullptr, true ); if( !data.empty() ){ enc.update( data ); }
+            }   if( zip->fd.is_failed() ){ WPGP_ERROR( self->onError, "Invalid WPGP message" ); }
+            enc.free(); string_t data;
+            if( bin ){ data = self->tail_to_memory( ctx ); } else {
+                data = string_t( krn->encode_size( 0, true ) + 1, '.' );
+                krn->encode( nullptr, 0, data.get(), true );
+            }   sha.update( data ); self->onData.emit( data + sha.get() );
+            self->end_pipe();
         });
-
-        auto data = string_t( (char*) &ctx, sizeof(CTX) ) + ".";
-             data+= encoder::base64::get( encoder::XOR::get(
-             obj->fd.public_encrypt( json::stringify( object_t({
-                { "type", "MESSAGE" }, { "pass", sec.get() },
-            }))), ctx.mask )) + "."; sha.update( data );
-
-        self->onData.emit( data ); stream::pipe( file );
     }
 
     template< class T, class V >
     void encrypt_pipe( const T& file, const V& fileB ) const noexcept {
-        onData([=]( string_t data ){ fileB.write( data ); });
+        sink_pipe( fileB );
         encrypt_pipe( file );
     }
 
     /*─······································································─*/
 
-    string_t decrypt_message( const string_t& msg ) const noexcept {
-        if( !verify_from_memory( msg ) )
-          { _EERROR( onError, "Invalid WPGP message" ); return nullptr; }
+    /* exact output size of encrypt_message_into for size plaintext bytes,
+       or 0 when no session key could be set up */
+    ulong encrypt_size( ulong size ) const noexcept {
+        if( !into_session() ){ return 0; } auto& s = obj->into;
+        ulong chunk = chunk_size(), count = size==0 ? 1 : ( size + chunk - 1 ) / chunk;
+        ulong last  = size - ( count - 1 ) * chunk, tag = wpgp::aead::TAG;
+        ulong out   = s.head.size() + item_size( s.ctx, SALT ) + HASH + ( is_binary( s.ctx ) ? 8 : 0 );
+        return out + ( count - 1 ) * item_size( s.ctx, chunk + tag ) + item_size( s.ctx, last + tag );
+    }
 
-        CTX  ctx ; memcpy( &ctx, msg.get(), sizeof( CTX ) );
-        auto pos = regex::search_all( msg, "[^.]+" ); pos.shift();
+    /* upper bound of decrypt_message_into's output; compressed messages
+       may inflate past it and are then refused by the raw buffer form */
+    ulong decrypt_size( const string_t& msg ) const noexcept { return msg.size(); }
 
-        auto header = json::parse( obj->fd.private_decrypt( 
-            encoder::XOR::get( encoder::base64::set(
-               msg.slice( pos[0][0], pos[0][1] )
-            ), ctx.mask )
-        ));
+    /* Writes a chunked message into out and returns its length, or -1
+       when out is shorter than encrypt_size( msg.size() ). Messages are
+       never compressed here. */
+    long encrypt_message_into( const string_t& msg, char* out, ulong size ) const noexcept {
+        long len = encrypt_into( msg, out, size );
+        if( len < 0 ){ WPGP_ERROR( onError, "Invalid WPGP message" ); } return len;
+    }
 
-        auto sec = header["pass"].as<string_t>();
+    /* as above, growing out when it is too short; out is meant to be
+       reused, so it is never shrunk and may be longer than the result */
+    long encrypt_message_into( const string_t& msg, string_t& out ) const noexcept {
+        ulong need = encrypt_size( msg.size() ); if( out.size() < need ){ out = string_t( need, '\0' ); }
+        return encrypt_message_into( msg, out.get(), out.size() );
+    }
 
-        auto dec = crypto::decrypt::AES_256_ECB( sec );
-             dec.update( encoder::XOR::get( encoder::base64::set(
-                msg.slice( pos[1][0], pos[1][1] )
-             ), ctx.mask ));
+    long decrypt_message_into( const string_t& msg, char* out, ulong size ) const noexcept {
+        long len = decrypt_into( msg, out, size );
+        if( len < 0 ){ WPGP_ERROR( onError, "Invalid WPGP message" ); } return len;
+    }
+
+    long decrypt_message_into( const string_t& msg, string_t& out ) const noexcept {
+        VIEW view; if( parse_from_memory( msg, view ) && ( view.ctx.flag & FLAG_ZIP ) ){
+            auto data = decrypt_message( msg ); if( data.empty() ){ return -1; }
+            if( out.size() < data.size() ){ out = string_t( data.size(), '\0' ); }
+            memcpy( out.get(), data.get(), data.size() ); return data.size();
+        }
+        if( out.size() < decrypt_size( msg ) ){ out = string_t( decrypt_size( msg ), '\0' ); }
+        return decrypt_message_into( msg, out.get(), out.size() );
+    }
+
+    /*─······································································─*/
+
+    string_t decrypt_message( const string_t& msg ) const noexcept { string_t out;
+        if( !decrypt_from_memory( msg, obj->fprt, out ) )
+          { WPGP_ERROR( onError, "Invalid WPGP message" ); return nullptr; }
+        return out;
+    }
 
-        return dec.get();
+    /* Runs the RSA / X25519 unwrap and the AEAD open of chunked bodies on
+       the worker pool and calls cb with the plaintext back on the event
+       loop. Parsing, the envelope hash, legacy ECB bodies and inflation
+       stay on the loop. Workers only see the raw buffers of the job and a
+       snapshot of the key taken here, which nothing else can reach, so
+       this object may be changed or copied while jobs are running. */
+    void decrypt_message_async( const string_t& msg, function_t<void,string_t> cb ) const noexcept {
+        struct JOB {
+            std::string head, key, body, out; std::vector<ITEM> item; SEAL seal; bool done=0;
+           ~JOB() noexcept { OPENSSL_cleanse( &seal, sizeof( SEAL ) );
+                if( !key.empty() ){ OPENSSL_cleanse( &key[0], key.size() ); }
+                if( !out.empty() ){ OPENSSL_cleanse( &out[0], out.size() ); }
+            }
+        };
+
+        auto self = type::bind( this ); auto job = std::make_shared<JOB>(); VIEW view; string_t head;
+        if( !parse_from_memory( msg, view ) || !verify_from_memory( msg, view ) )
+          { WPGP_ERROR( onError, "Invalid WPGP message" ); return; }
+        try { head = pick_header( view.ctx, decode_from_memory( msg, view, view.head ), obj->fprt ); }
+        catch(...) { WPGP_ERROR( onError, "Invalid WPGP message" ); return; }
+
+        auto body = [=]( const string_t& key ){
+            if( !( view.ctx.flag & FLAG_CHUNK ) ){ string_t out;
+                if( !self->decrypt_legacy( msg, view, key, out ) )
+                  { WPGP_ERROR( self->onError, "Invalid WPGP message" ); return; } cb( out ); return;
+            }
+
+            auto tok = self->body_from_memory( msg, view ); ulong pos = 0;
+            if( !read_seal( key, job->seal ) || !body_seal( view, tok, job->seal ) )
+              { WPGP_ERROR( self->onError, "Invalid WPGP message" ); return; }
+
+            for( auto& x : tok ){ if( x.size() < wpgp::aead::TAG )
+              { WPGP_ERROR( self->onError, "Invalid WPGP message" ); return; }
+                job->item.push_back({ nullptr, x.size() - wpgp::aead::TAG, pos });
+                pos += x.size() - wpgp::aead::TAG; job->body.append( x.get(), x.size() );
+            }
+
+            for( ulong x=0, off=0; x<job->item.size(); x++ ){ job->item[x].ptr = job->body.data() + off;
+                 off += job->item[x].len + wpgp::aead::TAG;
+            }   job->out.resize( pos ); char flag = view.ctx.flag;
+
+            wpgp::pool::async( [=](){ WPGP_STAGE( AEAD_OPEN, job->out.size() );
+                job->done = open_items( job->seal, 0, job->item.data(), job->item.size(), &job->out[0], true, flag );
+            }, [=](){
+                if( !job->done ){ WPGP_ERROR( self->onError, "Invalid WPGP message" ); return; }
+                auto out = string_t( job->out.data(), job->out.size() );
+                if( !self->unzip_message( view.ctx, out ) ){ WPGP_ERROR( self->onError, "Invalid WPGP message" ); return; }
+                cb( out );
+            });
+        };
+
+        string_t key; if( find_key( head, key ) ){ wpgp::pool::async( [](){}, [=](){ body( key ); } ); return; }
+        ptr_t<wpgp_t> snap = new wpgp_t( snapshot() ); const wpgp_t* pgp = &*snap;
+        job->head.assign( head.get(), head.size() );
+
+        wpgp::pool::async( [=](){
+            try { auto out = pgp->unwrap_raw( string_t( job->head.data(), job->head.size() ) );
+                  job->key.assign( out.get(), out.size() ); OPENSSL_cleanse( out.get(), out.size() );
+            } catch(...) {}
+        }, [=](){ if( snap.null() || job->key.empty() )
+              { WPGP_ERROR( self->onError, "Invalid WPGP message" ); return; }
+            auto key = string_t( job->key.data(), job->key.size() ); self->keep_key( head, key );
+            OPENSSL_cleanse( &job->key[0], job->key.size() ); body( key );
+            OPENSSL_cleanse( key.get(), key.size() );
+        });
     }
 
     template< class T >
     void decrypt_pipe( const T& file ) const noexcept {
     try {
 
-        auto xtc = file.read_until( '.' ); xtc.pop();
-        auto rdh = file.read_until( '.' ); rdh.pop();
-
+        auto xtc = read_exact( file, sizeof( CTX ) ); string_t pre, rdh; begin_pipe();
         CTX  ctx ; memcpy( &ctx, xtc.get(), sizeof( CTX ) );
 
-        auto hdr = json::parse( obj->fd.private_decrypt( 
-            encoder::XOR::get( encoder::base64::set( rdh ), ctx.mask )
-        ));
-            
-        auto sec = (string_t) hdr["pass"];
+        if( !is_valid( ctx ) ){ throw except_t( "Invalid WPGP message" ); } bool bin = is_binary( ctx );
 
-        auto dec = crypto::decrypt::AES_256_ECB( sec );
-        auto XOR = crypto::encrypt::XOR( ctx.mask );
-        auto b64 = crypto::decoder::BASE64();
-        auto hash= crypto::hash::SHA256();
-        auto self= type::bind( this );
-             
-        hash.update( xtc + "." + rdh + "." );
+        if( bin ){
+            auto len = read_exact( file, 4 );
+            rdh = read_exact( file, get_uint32( len.get() ) ); pre = xtc + len + rdh;
+        } else {
+            if( read_exact( file, 1 ) != "." ){ throw except_t( "Invalid WPGP message" ); }
+            rdh = file.read_until( '.' ); pre = xtc + "." + rdh; rdh.pop();
+            rdh = mask_decode( ctx, rdh.get(), rdh.size() );
+        }   rdh = pick_header( ctx, rdh, obj->fprt );
 
-        file.onDrain([=](){ dec.free(); b64.free(); self->onClose.emit(); });
-        dec .onData([=]( string_t data ){ self->onData.emit( data ); });
-        b64 .onData([=]( string_t data ){ XOR.update( data ); });
-        XOR .onData([=]( string_t data ){ dec.update( data ); });
-
-        process::add([=](){
-            if( !file.is_available() ){ return -1; }
-        coStart
+        if( ctx.flag & FLAG_CHUNK ){ decrypt_chunked_pipe( file, ctx, pre, rdh ); return; }
 
-            while( true ){ do {
-                auto dta = file.read();
-                auto atd = regex::match( dta, "[^.]+" );
+        auto hdr = parse_json( unwrap_key( rdh ) );
+        auto sec = (string_t) hdr["pass"]; if( !pass_zip( hdr, ctx ) ){ throw except_t( "Invalid WPGP message" ); }
 
-                hash.update( atd ); 
-                b64 .update( atd );
+        auto dec = crypto::decrypt::AES_256_ECB( sec );
+        ptr_t<wpgp::kernel_t> krn = new wpgp::kernel_t( ctx.mask, mask_size( ctx ) );
+        ptr_t<bool> fail = new bool( false ); auto self = type::bind( this );
+        ptr_t<ZIP>  zip  = new ZIP(); if( ctx.flag & FLAG_ZIP ){ zip->fd.start( true ); zip->fd.limit( obj->inflate ); }
 
-                if( !dta.find( '.' ).empty() ){ break; }
-            } while(0); coNext; }
+        dec .onData([=]( string_t data ){
+            data = unzip_data( *zip, data ); if( !data.empty() ){ self->onData.emit( data ); }
+        });
 
-            file.close();
-            
-        coStop
+        body_pipe( file, ctx, pre, [=]( string_t piece, bool, bool body_end ){
+            if( *fail ){ return; } if( bin ){ if( !piece.empty() ){ dec.update( piece ); } return; }
+            WPGP_STAGE( MASK, piece.size() );
+            auto out = string_t( krn->decode_size( piece.size() ) + 1, '\0' );
+            long len = krn->decode( piece.get(), piece.size(), out.get(), body_end );
+            if( len < 0 ){ *fail = 1; return; } if( len > 0 ){ dec.update( out.slice( 0, len ) ); }
+        }, [=]( bool valid ){ dec.free();
+            if( !valid || *fail || !unzip_done( *zip ) ){ WPGP_ERROR( self->onError, "Invalid WPGP message" ); }
+            self->end_pipe();
         });
 
     } catch (...) {
-        _EERROR( onError, "Invalid WPGP message" ); 
+        WPGP_ERROR( onError, "Invalid WPGP message" );
         return;
     }}
 
     template< class T, class V >
     void decrypt_pipe( const T& file, const V& fileB ) const noexcept {
-        onData([=]( string_t data ){ fileB.write( data ); });
+        sink_pipe( fileB );
         decrypt_pipe( file );
     }
 
+    /* Encrypts the file at path into pathB in the chunked format, without
+       the event loop and with large blocks; on linux the source is mapped
+       rather than read. Seekable output is honoured, compression is not.
+       Blocks until done, so run it off the event loop for large files. */
+    bool encrypt_file( const string_t& path, const string_t& pathB ) const noexcept {
+        if( file_to_file( path, pathB ) ){ return true; }
+        WPGP_ERROR( onError, "Invalid WPGP file" ); return false;
+    }
+
+    /* Decrypts length bytes at offset of the seekable message stored in
+       path, reading only its head, its index and the chunks that cover
+       the range. Each chunk is checked by its tag and its position, but
+       the hash over the whole file is not. */
+    string_t decrypt_range( const string_t& path, ulong offset, ulong length ) const noexcept {
+        string_t out; if( !read_range( path, offset, length, out ) )
+          { WPGP_ERROR( onError, "Invalid WPGP message" ); return nullptr; }
+        return out;
+    }
+
+    /*─······································································─*/
+
+    /* detached signature of msg; needs a private key */
+    string_t sign( const string_t& msg ) const noexcept {
+        uchar digest[ wpgp::sign::DIGEST ]; do { WPGP_STAGE( SHA256, msg.size() );
+            wpgp::sign::hash_t sha; sha.update( msg.get(), msg.size() ); sha.get( digest );
+        } while(0);
+
+        auto sig = sign_to_memory( digest ); if( sig.empty() )
+           { WPGP_ERROR( onError, "Invalid WPGP signature" ); } return sig;
+    }
+
+    bool verify( const string_t& msg, const string_t& sig ) const noexcept {
+        uchar digest[ wpgp::sign::DIGEST ]; do { WPGP_STAGE( SHA256, msg.size() );
+            wpgp::sign::hash_t sha; sha.update( msg.get(), msg.size() ); sha.get( digest );
+        } while(0); return verify_digest( digest, sig );
+    }
+
+    /* verifies msg[x] against sig[x] on the worker pool with the key
+       parsed once for the whole batch */
+    array_t<bool> verify( const array_t<string_t>& msg, const array_t<string_t>& sig ) const noexcept {
+        ulong count = min( msg.size(), sig.size() ); EVP_PKEY* key = sign_key();
+        array_t<string_t> head, raw; std::vector<uchar> done( count, 0 );
+
+        for( ulong x=0; x<count; x++ ){ string_t h, r;
+            done[x] = key != nullptr && open_signature( sig[x], h, r ); head.push( h ); raw.push( r );
+        }
+
+        std::vector<const char*> ptr( count * 3 ); std::vector<ulong> len( count * 3 );
+        for( ulong x=0; x<count; x++ ){
+            ptr[x*3+0] = msg [x].get(); len[x*3+0] = msg [x].size();
+            ptr[x*3+1] = head[x].get(); len[x*3+1] = head[x].size();
+            ptr[x*3+2] = raw [x].get(); len[x*3+2] = raw [x].size();
+        }
+
+        wpgp::pool::get().run( count, [&]( ulong x ){ if( !done[x] ){ return; }
+            uchar digest[ wpgp::sign::DIGEST ]; wpgp::sign::hash_t sha;
+            sha.update( ptr[x*3], len[x*3] ); sha.get( digest );
+            sign_digest( digest, ptr[x*3+1], len[x*3+1], digest );
+            done[x] = wpgp::sign::verify( key, digest, (const uchar*) ptr[x*3+2], len[x*3+2] );
+        });
+
+        array_t<bool> out; for( ulong x=0; x<msg.size(); x++ ){ out.push( x<count && done[x] ); }
+        return out;
+    }
+
+    /*─······································································─*/
+
+    /* hashes file as it streams and emits the signature through onData */
+    template< class T >
+    void sign_pipe( const T& file ) const noexcept {
+        auto sha = std::make_shared<wpgp::sign::hash_t>(); auto self = type::bind( this );
+        begin_pipe();
+
+        pump( file, [=]( string_t data ){ WPGP_STAGE( SHA256, data.size() );
+            sha->update( data.get(), data.size() );
+        }, [=](){ uchar digest[ wpgp::sign::DIGEST ]; sha->get( digest );
+            auto sig = self->sign_to_memory( digest ); if( sig.empty() )
+                 { WPGP_ERROR( self->onError, "Invalid WPGP signature" ); }
+            else { self->onData.emit( sig ); } self->end_pipe();
+        });
+    }
+
+    template< class T, class V >
+    void sign_pipe( const T& file, const V& fileB ) const noexcept {
+        sink_pipe( fileB );
+        sign_pipe( file );
+    }
+
+    /* hashes file as it streams and calls cb with the verification result */
+    template< class T >
+    void verify_pipe( const T& file, const string_t& sig, function_t<void,bool> cb ) const noexcept {
+        auto sha = std::make_shared<wpgp::sign::hash_t>(); auto self = type::bind( this );
+
+        pump( file, [=]( string_t data ){ WPGP_STAGE( SHA256, data.size() );
+            sha->update( data.get(), data.size() );
+        }, [=](){ uchar digest[ wpgp::sign::DIGEST ]; sha->get( digest );
+            cb( self->verify_digest( digest, sig ) );
+        });
+    }
+
     /*─······································································─*/
 
-    void free() const noexcept {
+    void free() const noexcept { clear_keys();
         if( obj->state == 0 ){ return; }
             obj->state =  0; onClose.emit();
     }
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2023 The Nodepp Project Authors. All Rights Reserved.
+ *
+ * Licensed under the MIT (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://github.com/NodeppOficial/nodepp/blob/main/LICENSE
+ */
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#ifndef NODEPP_WPGP_ZIP
+#define NODEPP_WPGP_ZIP
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#include <nodepp/nodepp.h>
+#include <zlib.h>
+
+#include <cstring>
+#include <string>
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+/* zlib deflate stage applied to plaintext before encryption. Whether a
+   message is worth compressing is decided from its first SAMPLE bytes,
+   so media and other compressed inputs skip the stage almost for free. */
+
+namespace nodepp { namespace wpgp { namespace zip {
+
+    enum { SAMPLE = 65536, BLOCK = 65536 };
+
+    /* streaming deflate or inflate; idle until start() */
+    class stream_t {
+        z_stream zs; bool inf=0, init=0, end=0, err=0; ulong max=0; ullong total=0;
+    public:
+        stream_t() noexcept { memset( &zs, 0, sizeof( zs ) ); }
+       ~stream_t() noexcept { if( !init ){ return; } if( inf ){ inflateEnd( &zs ); } else { deflateEnd( &zs ); } }
+        stream_t( const stream_t& ) = delete; stream_t& operator=( const stream_t& ) = delete;
+
+        bool start( bool inflate, int level=Z_DEFAULT_COMPRESSION ) noexcept {
+            if( init ){ return false; } inf = inflate;
+            init = ( inf ? inflateInit( &zs ) : deflateInit( &zs, level ) ) == Z_OK;
+            err = !init; return init;
+        }
+
+        /* fails the stream once the output of all its update() calls
+           together passes size bytes, so a small crafted input cannot
+           inflate without bound, however it is split; 0 is no limit */
+        void limit( ulong size ) noexcept { max = size; }
+
+        bool is_active() const noexcept { return init; }
+        bool is_failed() const noexcept { return err;  }
+        bool is_done()   const noexcept { return end && !err; }
+
+        /* feeds size bytes of in and returns whatever output is ready; last
+           finishes a deflate stream. Inflate fails on corrupt input and on
+           bytes past the end of the stream. */
+        string_t update( const char* in, ulong size, bool last ) noexcept {
+            if( !init || err ){ return nullptr; } std::string out; char buf[ BLOCK ];
+
+            while( true ){
+                if( zs.avail_in == 0 && size > 0 ){ uInt len = (uInt) min( size, 1073741824ul );
+                    zs.next_in = (Bytef*) in; zs.avail_in = len; in += len; size -= len;
+                }
+
+                zs.next_out = (Bytef*) buf; zs.avail_out = sizeof( buf );
+                int c = inf ? inflate( &zs, Z_NO_FLUSH ) : deflate( &zs, last && size == 0 ? Z_FINISH : Z_NO_FLUSH );
+                ulong got = sizeof( buf ) - zs.avail_out; out.append( buf, got ); total += got;
+                if( max > 0 && total > max ){ err = 1; return nullptr; }
+
+                if( c == Z_STREAM_END ){ end = 1;
+                    if( inf && ( zs.avail_in > 0 || size > 0 ) ){ err = 1; return nullptr; } break;
+                }   if( c != Z_OK && c != Z_BUF_ERROR ){ err = 1; return nullptr; }
+
+                if( zs.avail_out == 0 ){ continue; }
+                if( zs.avail_in == 0 && size == 0 && ( inf || !last ) ){ break; }
+                if( c == Z_BUF_ERROR ){ break; }
+            }
+
+            return string_t( out.data(), out.size() );
+        }
+    };
+
+    /*─······································································─*/
+
+    /* true when a fast deflate of the first SAMPLE bytes saves 10% or more */
+    inline bool worth( const char* data, ulong size ) noexcept {
+        ulong len = min( size, (ulong) SAMPLE ); if( len == 0 ){ return false; }
+        stream_t zip; if( !zip.start( false, 1 ) ){ return false; }
+        auto out = zip.update( data, len, true );
+        return zip.is_done() && out.size() * 10 <= len * 9;
+    }
+
+}}}
+
+/*────────────────────────────────────────────────────────────────────────────*/
+
+#endif